@@ -0,0 +1,62 @@
+#include "TWI.h"
+#include "Hardware/TWI.h"
+
+// Asynchronous transaction with the hardware bus manager (AVR or
+// SAM). Read the Si70XX user register in the background and count
+// the number of loop iterations available while the transfer is
+// active.
+
+Hardware::TWI twi;
+
+#if defined(AVR)
+ISR(TWI_vect)
+{
+  twi.isr();
+}
+#elif defined(SAM)
+void WIRE_ISR_HANDLER()
+{
+  twi.isr();
+}
+#endif
+
+// Si70XX device address and read user register command
+const uint8_t ADDR = (0x40 << 1);
+uint8_t cmd = 0xE7;
+uint8_t reg;
+
+void setup()
+{
+  Serial.begin(57600);
+  while (!Serial);
+}
+
+void loop()
+{
+  iovec_t vec[2];
+  iovec_t* vp = vec;
+  iovec_arg(vp, &cmd, sizeof(cmd));
+  iovec_end(vp);
+  TWI::transaction_t t = { ADDR, vec, &reg, sizeof(reg), NULL, NULL, 0, false };
+
+  // Start transaction and count iterations until completed; the
+  // watchdog aborts the transaction on timeout
+  uint32_t start = micros();
+  uint32_t count = 0;
+  twi.start(&t);
+  while (!t.completed) {
+    twi.watchdog();
+    count++;
+  }
+  uint32_t us = micros() - start;
+
+  Serial.print(F("res="));
+  Serial.print(t.result);
+  Serial.print(F(",reg="));
+  Serial.print(reg, HEX);
+  Serial.print(F(",us="));
+  Serial.print(us);
+  Serial.print(F(",count="));
+  Serial.println(count);
+  delay(1000);
+}
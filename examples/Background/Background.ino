@@ -0,0 +1,64 @@
+#include "GPIO.h"
+#include "TWI.h"
+#include "Software/TWI.h"
+
+// Background transaction with the software bus manager. The clock
+// edges are generated by the Timer1 compare match interrupt (AVR)
+// with twice the bit rate; 50 kHz bit rate. The CPU is free between
+// the clock edges. Read the Si70XX user register and count the
+// number of loop iterations available while the transfer is active.
+
+Software::TWI<BOARD::D18, BOARD::D19> twi;
+
+// Timer1 compare match; one clock phase (half bit) per interrupt
+const uint32_t BITRATE = 50000;
+
+ISR(TIMER1_COMPA_vect)
+{
+  twi.tick();
+}
+
+// Si70XX device address and read user register command
+const uint8_t ADDR = (0x40 << 1);
+uint8_t cmd = 0xE7;
+uint8_t reg;
+
+void setup()
+{
+  Serial.begin(57600);
+  while (!Serial);
+
+  // Timer1 in CTC mode, no prescale, compare match interrupt
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12) | _BV(CS10);
+  OCR1A = (F_CPU / (2 * BITRATE)) - 1;
+  TIMSK1 = _BV(OCIE1A);
+  interrupts();
+}
+
+void loop()
+{
+  iovec_t vec[2];
+  iovec_t* vp = vec;
+  iovec_arg(vp, &cmd, sizeof(cmd));
+  iovec_end(vp);
+  TWI::transaction_t t = { ADDR, vec, &reg, sizeof(reg), NULL, NULL, 0, false };
+
+  // Start transaction and count iterations until completed
+  uint32_t start = micros();
+  uint32_t count = 0;
+  twi.start(&t);
+  while (!t.completed) count++;
+  uint32_t us = micros() - start;
+
+  Serial.print(F("res="));
+  Serial.print(t.result);
+  Serial.print(F(",reg="));
+  Serial.print(reg, HEX);
+  Serial.print(F(",us="));
+  Serial.print(us);
+  Serial.print(F(",count="));
+  Serial.println(count);
+  delay(1000);
+}
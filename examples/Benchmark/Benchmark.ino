@@ -0,0 +1,63 @@
+#include "TWI.h"
+#include "Driver/Si70XX.h"
+
+// Benchmark virtual (TWI::Device) and static (TWI::Driver<BUS>)
+// device driver dispatch. Compare the sketch size reported by the
+// build for both settings and the per-transaction time printed.
+
+// Configure: Static device driver dispatch
+// #define USE_STATIC_DRIVER
+
+// Configure: TWI bus manager (software or hardware)
+// #define USE_SOFTWARE_TWI
+
+#if defined(USE_SOFTWARE_TWI)
+#include "GPIO.h"
+#include "Software/TWI.h"
+#if defined(SAM)
+typedef Software::TWI<BOARD::D8, BOARD::D9> Bus;
+#else
+typedef Software::TWI<BOARD::D18, BOARD::D19> Bus;
+#endif
+#else
+#include "Hardware/TWI.h"
+typedef Hardware::TWI Bus;
+#endif
+
+Bus twi;
+
+#if defined(USE_STATIC_DRIVER)
+Si70XXT<Bus> sensor(twi);
+#else
+Si70XX sensor(twi);
+#endif
+
+const uint16_t N = 1000;
+
+void setup()
+{
+  Serial.begin(57600);
+  while (!Serial);
+#if defined(USE_STATIC_DRIVER)
+  Serial.println(F("Benchmark: static dispatch"));
+#else
+  Serial.println(F("Benchmark: virtual dispatch"));
+#endif
+}
+
+void loop()
+{
+  // Measure register read transactions (write command, read value)
+  uint8_t reg = 0;
+  uint16_t errors = 0;
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < N; i++)
+    if (!sensor.read_user_register(reg)) errors++;
+  uint32_t us = micros() - start;
+
+  Serial.print(F("read_user_register:us="));
+  Serial.print(us / N);
+  Serial.print(F(",errors="));
+  Serial.println(errors);
+  delay(2000);
+}
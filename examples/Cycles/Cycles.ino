@@ -0,0 +1,60 @@
+#include "GPIO.h"
+#include "TWI.h"
+#include "Software/TWI.h"
+
+// Measure the software bus manager byte time in processor cycles
+// with no delays (as fast as GPIO access allows), with and without
+// clock stretching checks. Reads a block from an AT24CXX EEPROM
+// (sequential read; one address byte and BLOCK_MAX data bytes).
+
+#if defined(SAM)
+#define SDA BOARD::D8
+#define SCL BOARD::D9
+#else
+#define SDA BOARD::D18
+#define SCL BOARD::D19
+#endif
+
+Software::TWI<SDA, SCL, 0, true> twi;
+Software::TWI<SDA, SCL, 0, false> twi_ns;
+
+TWI::Device eeprom(twi, 0x50);
+TWI::Device eeprom_ns(twi_ns, 0x50);
+
+const size_t BLOCK_MAX = 64;
+const uint16_t N = 100;
+uint8_t block[BLOCK_MAX];
+
+void measure(TWI::Device& dev, const __FlashStringHelper* name)
+{
+  uint16_t errors = 0;
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < N; i++) {
+    if (!dev.acquire()) errors++;
+    if (dev.read(block, sizeof(block)) != (int) sizeof(block)) errors++;
+    if (!dev.release()) errors++;
+  }
+  uint32_t us = micros() - start;
+  uint32_t cycles = (us * (F_CPU / 1000000UL)) / N / (BLOCK_MAX + 1);
+
+  Serial.print(name);
+  Serial.print(F(":us="));
+  Serial.print(us / N);
+  Serial.print(F(",cycles/byte="));
+  Serial.print(cycles);
+  Serial.print(F(",errors="));
+  Serial.println(errors);
+}
+
+void setup()
+{
+  Serial.begin(57600);
+  while (!Serial);
+}
+
+void loop()
+{
+  measure(eeprom, F("clock stretching"));
+  measure(eeprom_ns, F("no clock stretching"));
+  delay(2000);
+}
@@ -1,3 +1,6 @@
+// Configure: Collect bus statistics (bytes per scratchpad read)
+// #define TWI_STATISTICS
+
 #include "GPIO.h"
 #include "TWI.h"
 #include "Driver/DS2482.h"
@@ -141,26 +144,60 @@ void loop()
   ASSERT(owi.one_wire_write_byte(CONVERT_T));
   delay(750);
 
+  // Read scratchpad byte per byte; a bus transaction per operation
+#if defined(TWI_STATISTICS)
+  TWI::statistics_t stats;
+  owi.statistics(stats, true);
+#endif
+  scratchpad_t scratchpad;
+  uint8_t* p = (uint8_t*) &scratchpad;
+  uint32_t start = micros();
   ASSERT(owi.one_wire_reset());
   ASSERT(owi.one_wire_write_byte(SKIP_ROM));
   ASSERT(owi.one_wire_write_byte(READ_SCRATCHPAD));
+  for (size_t i = 0; i < sizeof(scratchpad); i++)
+    ASSERT(owi.one_wire_read_byte(p[i]));
+  uint32_t byte_us = micros() - start;
+#if defined(TWI_STATISTICS)
+  owi.statistics(stats, true);
+  uint32_t byte_bytes = stats.bytes_read + stats.bytes_written;
+#endif
 
-  // Print scatchpad and calculate check sum
-  scratchpad_t scratchpad;
-  uint8_t* p = (uint8_t*) &scratchpad;
+  // Read scratchpad as a block within a single bus transaction
+  static const uint8_t cmd[] = { SKIP_ROM, READ_SCRATCHPAD };
   uint8_t crc = 0;
+  start = micros();
+  ASSERT(owi.acquire());
+  ASSERT(owi.one_wire_reset());
+  ASSERT(owi.one_wire_write(cmd, sizeof(cmd)));
+  ASSERT(owi.one_wire_read(p, sizeof(scratchpad), crc));
+  ASSERT(owi.release());
+  uint32_t block_us = micros() - start;
+  ASSERT(crc == 0);
+#if defined(TWI_STATISTICS)
+  owi.statistics(stats, true);
+  uint32_t block_bytes = stats.bytes_read + stats.bytes_written;
+#endif
+
+  // Print scatchpad and time per read
   Serial.print(F("read_scratchpad="));
   for (size_t i = 0; i < sizeof(scratchpad); i++) {
-    ASSERT(owi.one_wire_read_byte(p[i]));
     if (i == sizeof(scratchpad) - 1) Serial.print(F(",crc="));
     if (p[i] < 0x10) Serial.print('0');
     Serial.print(p[i], HEX);
-    crc = one_wire_crc_update(crc, p[i]);
   }
-  ASSERT(crc == 0);
+  Serial.print(F(",byte_us="));
+  Serial.print(byte_us);
+  Serial.print(F(",block_us="));
+  Serial.println(block_us);
+#if defined(TWI_STATISTICS)
+  Serial.print(F("bus_bytes:byte="));
+  Serial.print(byte_bytes);
+  Serial.print(F(",block="));
+  Serial.println(block_bytes);
+#endif
 
   // Print temperature (convert from fixed to floating point number)
-  Serial.print(',');
   float temperature = scratchpad.temperature * 0.0625;
   TRACE(temperature);
   delay(2000);
@@ -0,0 +1,80 @@
+#include "TWI.h"
+#include "Hardware/TWI.h"
+#include "Driver/Si70XX.h"
+
+// Arduino Due with two hardware buses; Wire (SDA/SCL) and Wire1
+// (SDA1/SCL1). Background transactions are started on both buses
+// and complete concurrently. The blocking device drivers work on
+// either bus.
+
+#if !defined(SAM)
+#error "DualBus: requires the SAM hardware bus manager"
+#endif
+
+Hardware::TWI twi(400000, Hardware::TWI::WIRE);
+Hardware::TWI twi1(100000, Hardware::TWI::WIRE1);
+
+void WIRE_ISR_HANDLER()
+{
+  twi.isr();
+}
+
+void WIRE1_ISR_HANDLER()
+{
+  twi1.isr();
+}
+
+// Si70XX sensor on each bus
+Si70XX sensor(twi);
+Si70XX sensor1(twi1);
+
+// Si70XX device address and read user register command
+const uint8_t ADDR = (0x40 << 1);
+uint8_t cmd = 0xE7;
+uint8_t reg;
+uint8_t reg1;
+
+void setup()
+{
+  Serial.begin(57600);
+  while (!Serial);
+}
+
+void loop()
+{
+  iovec_t vec[2];
+  iovec_t* vp = vec;
+  iovec_arg(vp, &cmd, sizeof(cmd));
+  iovec_end(vp);
+  TWI::transaction_t t = { ADDR, vec, &reg, sizeof(reg), NULL, NULL, 0, false };
+  TWI::transaction_t t1 = { ADDR, vec, &reg1, sizeof(reg1), NULL, NULL, 0, false };
+
+  // Start transactions on both buses and wait for completion
+  uint32_t start = micros();
+  twi.start(&t);
+  twi1.start(&t1);
+  twi.await(&t);
+  twi1.await(&t1);
+  uint32_t us = micros() - start;
+
+  Serial.print(F("res="));
+  Serial.print(t.result);
+  Serial.print(F(",res1="));
+  Serial.print(t1.result);
+  Serial.print(F(",reg="));
+  Serial.print(reg, HEX);
+  Serial.print(F(",reg1="));
+  Serial.print(reg1, HEX);
+  Serial.print(F(",us="));
+  Serial.println(us);
+
+  // Blocking measurements on both buses
+  sensor.measure_temperature();
+  sensor1.measure_temperature();
+  delay(20);
+  Serial.print(F("temperature="));
+  Serial.print(sensor.read_temperature());
+  Serial.print(F(",temperature1="));
+  Serial.println(sensor1.read_temperature());
+  delay(2000);
+}
@@ -0,0 +1,60 @@
+#include "GPIO.h"
+#include "TWI.h"
+#include "Software/TWI.h"
+#include "Driver/Si70XX.h"
+
+// Measure the clock frequency of the software bus manager for a
+// number of frequency settings (standard mode, fast mode, fast mode
+// plus and no delay), and the time per Si70XX register read.
+
+#if defined(SAM)
+#define SDA BOARD::D8
+#define SCL BOARD::D9
+#else
+#define SDA BOARD::D18
+#define SCL BOARD::D19
+#endif
+
+Software::TWI<SDA, SCL, 100000> twi100;
+Software::TWI<SDA, SCL, 400000> twi400;
+Software::TWI<SDA, SCL, 1000000> twi1000;
+Software::TWI<SDA, SCL, 0> twi0;
+
+const uint16_t N = 100;
+
+template<class BUS>
+void measure(BUS& twi, const __FlashStringHelper* name)
+{
+  Si70XXT<BUS> sensor(twi);
+  uint32_t freq = twi.calibrate();
+  uint16_t errors = 0;
+  uint8_t reg;
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < N; i++)
+    if (!sensor.read_user_register(reg)) errors++;
+  uint32_t us = micros() - start;
+
+  Serial.print(name);
+  Serial.print(F(":scl:hz="));
+  Serial.print(freq);
+  Serial.print(F(",read_user_register:us="));
+  Serial.print(us / N);
+  Serial.print(F(",errors="));
+  Serial.println(errors);
+}
+
+void setup()
+{
+  Serial.begin(57600);
+  while (!Serial);
+}
+
+void loop()
+{
+  measure(twi100, F("100 kHz"));
+  measure(twi400, F("400 kHz"));
+  measure(twi1000, F("1 MHz"));
+  measure(twi0, F("no delay"));
+  Serial.println();
+  delay(2000);
+}
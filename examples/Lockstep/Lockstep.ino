@@ -0,0 +1,50 @@
+#include "GPIO.h"
+#include "TWI.h"
+#include "Software/LockstepTWI.h"
+
+// Read four Si70XX sensors with the same device address in lockstep
+// (AVR). Shared clock signal on D19 and data signals on D8..D11
+// (PORTB bit 0..3 on Arduino Uno), each with a pull-up resistor.
+// The user register of all sensors is read in the time of one.
+
+const uint8_t LANES = 4;
+Software::LockstepTWI<BOARD::D8, BOARD::D19, LANES> twi;
+
+// Si70XX device address and read user register command
+const uint8_t ADDR = (0x40 << 1);
+uint8_t cmd = 0xE7;
+
+void setup()
+{
+  Serial.begin(57600);
+  while (!Serial);
+}
+
+void loop()
+{
+  uint8_t reg[LANES];
+  iovec_t vec[2];
+  iovec_t* vp = vec;
+  iovec_arg(vp, &cmd, sizeof(cmd));
+  iovec_end(vp);
+
+  uint32_t start = micros();
+  uint8_t idle = twi.acquire();
+  uint8_t ack = twi.write_read(ADDR, vec, reg, sizeof(reg[0]));
+  twi.release();
+  uint32_t us = micros() - start;
+
+  Serial.print(F("idle="));
+  Serial.print(idle, BIN);
+  Serial.print(F(",ack="));
+  Serial.print(ack, BIN);
+  for (uint8_t lane = 0; lane < LANES; lane++) {
+    Serial.print(F(",reg["));
+    Serial.print(lane);
+    Serial.print(F("]="));
+    Serial.print(reg[lane], HEX);
+  }
+  Serial.print(F(",us="));
+  Serial.println(us);
+  delay(1000);
+}
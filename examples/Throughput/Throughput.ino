@@ -0,0 +1,90 @@
+#include "TWI.h"
+#include "Hardware/TWI.h"
+
+// Compare bulk transfer throughput of the SAM hardware bus manager
+// with Peripheral DMA Controller (PDC) transfers and with the byte
+// loop. Writes a page to an AT24CXX EEPROM and reads it back.
+
+#if !defined(SAM)
+#error "Throughput: requires the SAM hardware bus manager"
+#endif
+
+Hardware::TWI twi(400000);
+
+// AT24CXX EEPROM device driver with 16-bit address
+class EEPROM : public TWI::Device {
+public:
+  EEPROM(TWI& twi) : TWI::Device(twi, 0x50) {}
+
+  int write(uint16_t addr, void* buf, size_t count)
+  {
+    uint8_t adr[2] = { (uint8_t) (addr >> 8), (uint8_t) addr };
+    iovec_t vec[3];
+    iovec_t* vp = vec;
+    iovec_arg(vp, adr, sizeof(adr));
+    iovec_arg(vp, buf, count);
+    iovec_end(vp);
+    if (!acquire()) return (-1);
+    int res = TWI::Device::write(vec);
+    if (!release()) return (-1);
+    return (res);
+  }
+
+  int read(uint16_t addr, void* buf, size_t count)
+  {
+    uint8_t adr[2] = { (uint8_t) (addr >> 8), (uint8_t) addr };
+    if (!acquire()) return (-1);
+    int res = write_read(adr, sizeof(adr), buf, count);
+    if (!release()) return (-1);
+    return (res);
+  }
+};
+
+EEPROM eeprom(twi);
+
+// Page size and number of measurements
+const size_t PAGE_MAX = 32;
+const uint16_t N = 100;
+uint8_t page[PAGE_MAX];
+
+void measure(const __FlashStringHelper* name, size_t threshold)
+{
+  uint32_t rus = 0;
+  uint32_t wus = 0;
+  uint16_t errors = 0;
+  uint32_t start;
+
+  twi.pdc_threshold(threshold);
+  for (uint16_t i = 0; i < N; i++) {
+    start = micros();
+    if (eeprom.write(0, page, sizeof(page)) != sizeof(page)) errors++;
+    wus += micros() - start;
+    delay(5);
+    start = micros();
+    if (eeprom.read(0, page, sizeof(page)) != sizeof(page)) errors++;
+    rus += micros() - start;
+  }
+  Serial.print(name);
+  Serial.print(F(":write:us="));
+  Serial.print(wus / N);
+  Serial.print(F(",read:us="));
+  Serial.print(rus / N);
+  Serial.print(F(",read:kbyte/s="));
+  Serial.print((1000.0 * sizeof(page) * N) / rus);
+  Serial.print(F(",errors="));
+  Serial.println(errors);
+}
+
+void setup()
+{
+  Serial.begin(57600);
+  while (!Serial);
+  for (size_t i = 0; i < sizeof(page); i++) page[i] = i;
+}
+
+void loop()
+{
+  measure(F("byte loop"), 0);
+  measure(F("pdc"), 16);
+  delay(2000);
+}
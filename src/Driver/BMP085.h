@@ -46,8 +46,11 @@
  * @section References
  * 1. http://media.digikey.com/pdf/Data%20Sheets/Bosch/BMP085.pdf
  * BST-BMP085-DS000-03, Rev. 1.0, 01 July 2008.
+ *
+ * @param[in] BUS bus manager class.
  */
-class BMP085 : protected TWI::Device {
+template<class BUS>
+class BMP085T : protected TWI::Driver<BUS> {
 public:
   /**
    * Oversampling modes (table, pp. 10).
@@ -63,8 +66,8 @@ public:
    * Construct BMP085 driver with I2C address(0x77) and default
    * ULTRA_LOW_POWER mode.
    */
-  BMP085(TWI& twi) :
-    TWI::Device(twi, 0x77),
+  BMP085T(BUS& twi) :
+    TWI::Driver<BUS>(twi, 0x77),
     m_mode(ULTRA_LOW_POWER),
     m_cmd(0),
     m_start(0),
@@ -85,9 +88,7 @@ public:
 
     // Read coefficients from the device
     if (!acquire()) return (false);
-    uint8_t reg = COEFF_REG;
-    write(&reg, sizeof(reg));
-    int res = read(&m_param, sizeof(m_param));
+    int res = read_register((uint8_t) COEFF_REG, &m_param, sizeof(m_param));
     if (!release()) return (false);
     if (res != sizeof(m_param)) return (false);
 
@@ -137,11 +138,9 @@ public:
     if (run < TEMP_CONV_MS) delay(TEMP_CONV_MS - run);
 
     // Read the raw temperature sensor data
-    uint8_t reg = RES_REG;
     int16_t UT;
     if (!acquire()) return (false);
-    write(&reg, sizeof(reg));
-    read(&UT, sizeof(UT));
+    read_register((uint8_t) RES_REG, &UT, sizeof(UT));
     if (!release()) return (false);
 
     // Adjust for little-endian
@@ -213,10 +212,8 @@ public:
       uint8_t as_uint8[4];
     } res;
     res.as_uint8[0] = 0;
-    uint8_t reg = RES_REG;
     if (!acquire()) return (false);
-    write(&reg, sizeof(reg));
-    read(&res.as_uint8[1], 3);
+    read_register((uint8_t) RES_REG, &res.as_uint8[1], 3);
     if (!release()) return (false);
 
     // Adjust for little endian and resolution (oversampling mode)
@@ -344,6 +341,18 @@ protected:
 
   /** Latest calculated pressure. */
   int32_t m_pressure;
+
+  /** Device driver base class. */
+  typedef TWI::Driver<BUS> Device;
+  using Device::acquire;
+  using Device::release;
+  using Device::write;
+  using Device::read_register;
 };
 
+/**
+ * BMP085 device driver for the abstract bus manager.
+ */
+typedef BMP085T<TWI> BMP085;
+
 #endif
@@ -24,19 +24,37 @@
 /**
  * TWI Device Driver for DS2482, Single-Channel 1-Wire Master, TWI to
  * OWI Bridge Device.
+ * @param[in] BUS bus manager class.
  */
-class DS2482 : protected TWI::Device {
+template<class BUS>
+class DS2482T : protected TWI::Driver<BUS> {
 public:
   /**
    * Construct one wire bus manager for DS2482.
    * @param[in] twi bus manager.
    * @param[in] subaddr sub-address for device (0..3).
    */
-  DS2482(TWI& twi, uint8_t subaddr = 0) :
-    TWI::Device(twi, 0x18 | (subaddr & 0x03))
+  DS2482T(BUS& twi, uint8_t subaddr = 0) :
+    TWI::Driver<BUS>(twi, 0x18 | (subaddr & 0x03))
   {
+    Device::retry(TWI::Retry(POLL_MAX, 0, TWI::Retry::SPIN));
   }
 
+  /**
+   * Retry policy for polling the device status while a one wire
+   * operation is in progress. Default polls back-to-back at most
+   * POLL_MAX times.
+   */
+  using TWI::Driver<BUS>::retry;
+
+  /**
+   * Start and stop transaction; a sequence of one wire operations
+   * may be performed within a single bus transaction. The operations
+   * are nested and use repeated start conditions.
+   */
+  using TWI::Driver<BUS>::acquire;
+  using TWI::Driver<BUS>::release;
+
   /**
    * Reset the one wire bus and check that at least one device is
    * presence.
@@ -51,13 +69,13 @@ public:
 
     // Issue one wire reset command
     cmd = ONE_WIRE_RESET;
-    if (!TWI::Device::acquire()) return (false);
-    count = TWI::Device::write(&cmd, sizeof(cmd));
+    if (!Device::acquire()) return (false);
+    count = Device::write(&cmd, sizeof(cmd));
     if (count != sizeof(cmd)) goto error;
     if (one_wire_await(status)) res = status.PPD;
 
   error:
-    if (!TWI::Device::release()) return (false);
+    if (!Device::release()) return (false);
     return (res);
   }
 
@@ -77,8 +95,8 @@ public:
     // Issue one wire single bit command with read data time slot
     cmd[0] = ONE_WIRE_SINGLE_BIT;
     cmd[1] = 0x80;
-    if (!TWI::Device::acquire()) return (false);
-    count = TWI::Device::write(cmd, sizeof(cmd));
+    if (!Device::acquire()) return (false);
+    count = Device::write(cmd, sizeof(cmd));
     if (count != sizeof(cmd)) goto error;
 
     // Wait for one wire operation to complete
@@ -86,7 +104,7 @@ public:
     value = status.SBR;
 
   error:
-    if (!TWI::Device::release()) return (false);
+    if (!Device::release()) return (false);
     return (res);
   }
 
@@ -106,13 +124,13 @@ public:
     // Issue one wire single bit command with given data
     cmd[0] = ONE_WIRE_SINGLE_BIT;
     cmd[1] = (value ? 0x80 : 0x00);
-    if (!TWI::Device::acquire()) return (false);
-    count = TWI::Device::write(cmd, sizeof(cmd));
+    if (!Device::acquire()) return (false);
+    count = Device::write(cmd, sizeof(cmd));
     if (count != sizeof(cmd)) goto error;
     res = one_wire_await(status);
 
   error:
-    if (!TWI::Device::release()) return (false);
+    if (!Device::release()) return (false);
     return (res);
   }
 
@@ -127,23 +145,22 @@ public:
     status_t status;
     uint8_t cmd;
     int count;
+    bool res = false;
 
     // Issue one wire read byte command
     cmd = ONE_WIRE_READ_BYTE;
-    if (!TWI::Device::acquire()) return (false);
-    count = TWI::Device::write(&cmd, sizeof(cmd));
+    if (!Device::acquire()) return (false);
+    count = Device::write(&cmd, sizeof(cmd));
     if (count != sizeof(cmd)) goto error;
 
-    // Wait for one wire operation to complete
-    if (!one_wire_await(status)) goto error;
-    if (!TWI::Device::release()) return (false);
-
-    // Read data register value
-    return (set_read_pointer(READ_DATA_REGISTER, value));
+    // Wait for one wire operation to complete and read data register
+    // value within the transaction
+    if (one_wire_await(status))
+      res = set_read_pointer(READ_DATA_REGISTER, value);
 
   error:
-    TWI::Device::release();
-    return (false);
+    if (!Device::release()) return (false);
+    return (res);
   }
 
   /**
@@ -162,16 +179,102 @@ public:
     // Issue one wire write byte command with given data
     cmd[0] = ONE_WIRE_WRITE_BYTE;
     cmd[1] = value;
-    if (!TWI::Device::acquire()) return (res);
-    count = TWI::Device::write(cmd, sizeof(cmd));
+    if (!Device::acquire()) return (res);
+    count = Device::write(cmd, sizeof(cmd));
     if (count != sizeof(cmd)) goto error;
     res = one_wire_await(status);
 
   error:
-    if (!TWI::Device::release()) return (false);
+    if (!Device::release()) return (false);
+    return (res);
+  }
+
+  /**
+   * Read given number of bytes from one wire bus into given buffer
+   * within a single bus transaction. The given CRC-8 is updated with
+   * the bytes read; zero(0) when the last byte read is the CRC of
+   * the block and the initial value was zero(0). Returns true(1) if
+   * successful otherwise false(0).
+   * @param[in] buf buffer pointer.
+   * @param[in] count number of bytes to read.
+   * @param[in,out] crc CRC-8 value.
+   * @return bool.
+   */
+  bool one_wire_read(void* buf, size_t count, uint8_t& crc)
+  {
+    uint8_t* bp = (uint8_t*) buf;
+    bool res = true;
+
+    // Read bytes with repeated start conditions; stop on error
+    if (!Device::acquire()) return (false);
+    while (res && count--) {
+      res = one_wire_read_byte(*bp);
+      crc = crc_update(crc, *bp++);
+    }
+    if (!Device::release()) return (false);
+    return (res);
+  }
+
+  /**
+   * Read given number of bytes from one wire bus into given buffer
+   * within a single bus transaction. Returns true(1) if successful
+   * otherwise false(0).
+   * @param[in] buf buffer pointer.
+   * @param[in] count number of bytes to read.
+   * @return bool.
+   */
+  bool one_wire_read(void* buf, size_t count)
+  {
+    uint8_t crc = 0;
+    return (one_wire_read(buf, count, crc));
+  }
+
+  /**
+   * Write given number of bytes from given buffer to one wire bus
+   * within a single bus transaction. Returns true(1) if successful
+   * otherwise false(0).
+   * @param[in] buf buffer pointer.
+   * @param[in] count number of bytes to write.
+   * @return bool.
+   */
+  bool one_wire_write(const void* buf, size_t count)
+  {
+    const uint8_t* bp = (const uint8_t*) buf;
+    bool res = true;
+
+    // Write bytes with repeated start conditions; stop on error
+    if (!Device::acquire()) return (false);
+    while (res && count--) res = one_wire_write_byte(*bp++);
+    if (!Device::release()) return (false);
     return (res);
   }
 
+  /**
+   * Update one wire CRC-8 (polynomial x^8 + x^5 + x^4 + 1) with
+   * given data byte. Returns updated CRC.
+   * @param[in] crc current value.
+   * @param[in] data byte.
+   * @return crc.
+   */
+  static uint8_t crc_update(uint8_t crc, uint8_t data)
+  {
+    crc = crc ^ data;
+    for (uint8_t i = 0; i < 8; i++) {
+      if (crc & 0x01)
+	crc = (crc >> 1) ^ 0x8C;
+      else
+	crc >>= 1;
+    }
+    return (crc);
+  }
+
+#if defined(TWI_STATISTICS)
+  /**
+   * Device bus statistics.
+   */
+  using TWI::Driver<BUS>::statistics;
+#endif
+
   /**
    * Search (rom and alarm) support function. Reads 2-bits and writes
    * given direction 1-bit value when discrepancy 0b00 read. Writes
@@ -185,23 +288,24 @@ public:
     status_t status;
     uint8_t cmd[2];
     int count;
+    int8_t res = -1;
 
     // Issue one wire single bit command with given data
     cmd[0] = ONE_WIRE_TRIPLET;
     cmd[1] = (dir ? 0x80 : 0x00);
-    if (!TWI::Device::acquire()) return (-1);
-    count = TWI::Device::write(cmd, sizeof(cmd));
+    if (!Device::acquire()) return (-1);
+    count = Device::write(cmd, sizeof(cmd));
     if (count != sizeof(cmd)) goto error;
 
     // Wait for one wire operation to complete
-    if (!one_wire_await(status)) goto error;
-    if (!TWI::Device::release()) return (-1);
-    dir = status.DIR;
-    return ((status >> 5) & 0x3);
+    if (one_wire_await(status)) {
+      dir = status.DIR;
+      res = (status >> 5) & 0x3;
+    }
 
   error:
-    TWI::Device::release();
-    return (-1);
+    if (!Device::release()) return (-1);
+    return (res);
   }
 
   /**
@@ -215,20 +319,12 @@ public:
     uint8_t cmd;
     int count;
 
-    // Issue device reset command
+    // Issue device reset command and check status register
     cmd = DEVICE_RESET;
-    if (!TWI::Device::acquire()) return (false);
-    count = TWI::Device::write(&cmd, sizeof(cmd));
-    if (count != sizeof(cmd)) goto error;
-
-    // Check status register for device reset
-    count = TWI::Device::read(&status, sizeof(status));
-    if (!TWI::Device::release()) return (false);
+    if (!Device::acquire()) return (false);
+    count = Device::write_read(&cmd, sizeof(cmd), &status, sizeof(status));
+    if (!Device::release()) return (false);
     return ((count == sizeof(status)) && status.RST);
-
-  error:
-    TWI::Device::release();
-    return (false);
   }
 
   /**
@@ -252,21 +348,14 @@ public:
     config.IWS = iws;
     config.COMP = ~config;
 
-    // Issue write configuration command with given setting
+    // Issue write configuration command with given setting and
+    // read status to check configuration
     cmd[0] = WRITE_CONGIFURATION;
     cmd[1] = config;
-    if (!TWI::Device::acquire()) return (false);
-    count = TWI::Device::write(cmd, sizeof(cmd));
-    if (count != sizeof(cmd)) goto error;
-
-    // Read status and check configuration
-    count = TWI::Device::read(&status, sizeof(status));
-    if (!TWI::Device::release()) return (false);
+    if (!Device::acquire()) return (false);
+    count = Device::write_read(cmd, sizeof(cmd), &status, sizeof(status));
+    if (!Device::release()) return (false);
     return ((count == sizeof(status)) && !status.RST);
-
-  error:
-    TWI::Device::release();
-    return (false);
   }
 
   /**
@@ -288,24 +377,16 @@ public:
    */
   bool set_read_pointer(Register addr, uint8_t& value)
   {
-    uint8_t cmd[2];
+    uint16_t reg;
     int count;
-    bool res = false;
-
-    // Issue set read pointer command with given pointer
-    cmd[0] = SET_READ_POINTER;
-    cmd[1] = (uint8_t) addr;
-    if (!TWI::Device::acquire()) return (false);
-    count = TWI::Device::write(cmd, sizeof(cmd));
-    if (count != sizeof(cmd)) goto error;
 
-    // Read register value
-    count = TWI::Device::read(&value, sizeof(value));
-    res = (count == sizeof(value));
-
-  error:
-    if (!TWI::Device::release()) return (false);
-    return (res);
+    // Issue set read pointer command with given pointer and read
+    // register value
+    reg = (SET_READ_POINTER << 8) | addr;
+    if (!Device::acquire()) return (false);
+    count = Device::read_register((uint32_t) reg, 2, &value, sizeof(value));
+    if (!Device::release()) return (false);
+    return (count == sizeof(value));
   }
 
   /**
@@ -325,13 +406,16 @@ public:
     // Issue channel select command with channel code
     cmd[0] = CHANNEL_SELECT;
     cmd[1] = (~chan << 4) | chan;
-    if (!TWI::Device::acquire()) return (false);
-    count = TWI::Device::write(cmd, sizeof(cmd));
-    if (!TWI::Device::release()) return (false);
+    if (!Device::acquire()) return (false);
+    count = Device::write(cmd, sizeof(cmd));
+    if (!Device::release()) return (false);
     return (count == sizeof(cmd));
   }
 
 protected:
+  /** Device driver base class. */
+  typedef TWI::Driver<BUS> Device;
+
   /**
    * Function Commands, pp. 9-15.
    */
@@ -395,19 +479,28 @@ protected:
 
   /**
    * Wait for the one wire operation to complete. Poll the device
-   * status.
+   * status according to the retry policy; fail directly on errors
+   * that are not retried.
    * @param[out] status device status on completion.
    * @return true(1) if successful otherwise false(0).
    */
   bool one_wire_await(status_t& status)
   {
     // Wait for one wire operation to complete
-    for (int i = 0; i < POLL_MAX; i++) {
-      int count = TWI::Device::read(&status, sizeof(status));
+    const TWI::Retry& policy = Device::retry();
+    for (uint8_t attempt = 1;; attempt++) {
+      int count = Device::read(&status, sizeof(status));
       if (count == sizeof(status) && !status.IWB) return (true);
+      if (count < 0 && !policy.retryable(count)) break;
+      if (attempt >= policy.attempts()) break;
+      policy.wait(attempt);
     }
     return (false);
   }
-
 };
+
+/**
+ * DS2482 device driver for the abstract bus manager.
+ */
+typedef DS2482T<TWI> DS2482;
 #endif
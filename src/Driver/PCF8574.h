@@ -42,8 +42,11 @@
  *
  * @section References
  * 1. NXP Semiconductors Product data sheet, Rev. 5, 27 May 2013.
+ *
+ * @param[in] BUS bus manager class.
  */
-class PCF8574 : protected TWI::Device {
+template<class BUS>
+class PCF8574T : protected TWI::Driver<BUS> {
 public:
   /**
    * Construct connection to PCF8574 Remote 8-bit I/O expander with
@@ -51,8 +54,8 @@ public:
    * @param[in] twi bus manager.
    * @param[in] subaddr sub-address (0..7, default 7).
    */
-  PCF8574(TWI& twi, uint8_t subaddr = 7) :
-    TWI::Device(twi, 0x20 | (subaddr & 0x7)),
+  PCF8574T(BUS& twi, uint8_t subaddr = 7) :
+    TWI::Driver<BUS>(twi, 0x20 | (subaddr & 0x7)),
     m_ddr(0xff),
     m_port(0)
   {}
@@ -141,7 +144,7 @@ public:
     /**
      * Construct pin handler with given PCF8574 device driver.
      */
-    GPIO(PCF8574& dev) : m_dev(dev) {}
+    GPIO(PCF8574T& dev) : m_dev(dev) {}
 
     /**
      * Set input mode.
@@ -209,7 +212,7 @@ public:
     }
 
   protected:
-    PCF8574& m_dev;
+    PCF8574T& m_dev;
   };
 
 protected:
@@ -226,14 +229,20 @@ protected:
    * @param[in] addr bus address.
    * @param[in] subaddr device sub address.
    */
-  PCF8574(TWI& twi, uint8_t addr, uint8_t subaddr) :
-    TWI::Device(twi, addr | (subaddr & 0x7)),
+  PCF8574T(BUS& twi, uint8_t addr, uint8_t subaddr) :
+    TWI::Driver<BUS>(twi, addr | (subaddr & 0x7)),
     m_ddr(0xff),
     m_port(0)
   {}
+
+  /** Device driver base class. */
+  typedef TWI::Driver<BUS> Device;
+  using Device::acquire;
+  using Device::release;
 };
 
-class PCF8574A : public PCF8574 {
+template<class BUS>
+class PCF8574AT : public PCF8574T<BUS> {
 public:
   /**
    * Construct connection to PCF8574A Remote 8-bit I/O expander with
@@ -241,6 +250,12 @@ public:
    * @param[in] twi bus manager.
    * @param[in] subaddr sub-address (0..7, default 7).
    */
-  PCF8574A(TWI& twi, uint8_t subaddr = 7) : PCF8574(twi, 0x38, subaddr) {}
+  PCF8574AT(BUS& twi, uint8_t subaddr = 7) : PCF8574T<BUS>(twi, 0x38, subaddr) {}
 };
+
+/**
+ * PCF8574 and PCF8574A device drivers for the abstract bus manager.
+ */
+typedef PCF8574T<TWI> PCF8574;
+typedef PCF8574AT<TWI> PCF8574A;
 #endif
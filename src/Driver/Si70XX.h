@@ -47,15 +47,27 @@
  * @section References
  * 1. http://www.silabs.com/products/sensors/humidity-sensors/Pages/si7013-20-21.aspx
  * 2. https://www.silabs.com/Support%20Documents/TechnicalDocs/Si7020-A20.pdf, Rev. 1.1 6/15.
+ *
+ * @param[in] BUS bus manager class.
  */
-class Si70XX : protected TWI::Device {
+template<class BUS>
+class Si70XXT : protected TWI::Driver<BUS> {
 public:
   /**
    * Create device driver instance.
    */
-  Si70XX(TWI& twi) :
-    TWI::Device(twi, 0x40)
-  {}
+  Si70XXT(BUS& twi) :
+    TWI::Driver<BUS>(twi, 0x40)
+  {
+    Device::retry(TWI::Retry(CONVERSION_RETRY_MAX, CONVERSION_BACKOFF));
+  }
+
+  /**
+   * Retry policy for reading measurements; the device does not
+   * acknowledge the address while measuring. Default polls every
+   * 500 us for at most 25 ms.
+   */
+  using TWI::Driver<BUS>::retry;
 
   /**
    * Read configuration register, Return true(1) if successful
@@ -86,9 +98,7 @@ public:
     // Read SNA and check crc
     if (!acquire()) return (false);
     cmd = READ_ID_1;
-    count = write(&cmd, sizeof(cmd));
-    if (count != sizeof(cmd)) goto err;
-    count = read(sna, sizeof(sna));
+    count = write_read(&cmd, sizeof(cmd), sna, sizeof(sna));
     if (count != sizeof(sna)) goto err;
     crc = 0;
     j = 0;
@@ -100,9 +110,7 @@ public:
 
     // Read SNB and check crc
     cmd = READ_ID_2;
-    count = write(&cmd, sizeof(cmd));
-    if (count != sizeof(cmd)) goto err;
-    count = read(&snb, sizeof(snb));
+    count = write_read(&cmd, sizeof(cmd), snb, sizeof(snb));
     if (count != sizeof(snb)) goto err;
     crc = 0;
     for (size_t i = 0; i < sizeof(snb); ) {
@@ -130,8 +138,7 @@ public:
     uint16_t cmd = READ_REV;
     int count = 0;
     if (!acquire()) return (false);
-    count = write(&cmd, sizeof(cmd));
-    count = read(&rev, sizeof(rev));
+    count = write_read(&cmd, sizeof(cmd), &rev, sizeof(rev));
     if (!release()) return (false);
     return (count == sizeof(rev));
   }
@@ -154,7 +161,7 @@ public:
   float read_humidity()
   {
     uint16_t value;
-    if (!read(value)) (NAN);
+    if (!read(value)) return (NAN);
     return (((125.00 * value) / 65536) - 6.00);
   }
 
@@ -212,6 +219,12 @@ protected:
     READ_REV = 0xB884		 //!< Read Firmware Revision
   } __attribute__((packed));
 
+  /** Maximum number of read attempts while measuring. */
+  static const uint8_t CONVERSION_RETRY_MAX = 50;
+
+  /** Delay between read attempts while measuring (us). */
+  static const uint16_t CONVERSION_BACKOFF = 500;
+
   /**
    * Issue given command. Return true(1) if successful otherwise false(0).
    * @param[in] cmd command.
@@ -234,26 +247,27 @@ protected:
    */
   bool read(uint16_t& value, bool check = true)
   {
-    uint8_t buf[3];
+    iovec_t vec[3];
+    iovec_t* vp = vec;
+    uint8_t crc;
     int size;
     int count = 0;
 
-    size = check ? sizeof(buf) : sizeof(buf) - 1;
-    for (int retry = 0; retry < 20; retry++) {
-      if (acquire()) {
-	count = read(buf, size);
-	if (release() && count != -1) break;
-      }
-      delay(1);
-    }
+    // Read value and crc (optional) directly into destination
+    iovec_arg(vp, &value, sizeof(value));
+    if (check) iovec_arg(vp, &crc, sizeof(crc));
+    iovec_end(vp);
+    size = check ? sizeof(value) + sizeof(crc) : sizeof(value);
+    // Retry while measuring according to retry policy
+    count = transfer(NULL, vec);
     if (count != size) return (false);
-    value = ((buf[0] << 8) | buf[1]);
+    value = bswap16(value);
     if (!check) return (true);
 
-    uint8_t crc;
-    crc = crc_update(0, buf[0]);
-    crc = crc_update(crc, buf[1]);
-    return (crc == buf[2]);
+    uint8_t sum;
+    sum = crc_update(0, value >> 8);
+    sum = crc_update(sum, value);
+    return (sum == crc);
   }
 
   /**
@@ -268,8 +282,7 @@ protected:
     uint8_t reg;
     int count = 0;
     if (!acquire()) return (false);
-    write(&cmd, sizeof(cmd));
-    count = read(&reg, sizeof(reg));
+    count = read_register(cmd, &reg, sizeof(reg));
     if (!release() || count != sizeof(reg)) return (false);
     value = reg;
     return (true);
@@ -286,7 +299,20 @@ protected:
     return (crc);
   }
 
+  /** Device driver base class. */
+  typedef TWI::Driver<BUS> Device;
+  using Device::acquire;
+  using Device::release;
+  using Device::transfer;
   using Device::read;
+  using Device::write;
+  using Device::write_read;
+  using Device::read_register;
 };
 
+/**
+ * Si70XX device driver for the abstract bus manager.
+ */
+typedef Si70XXT<TWI> Si70XX;
+
 #endif
@@ -31,7 +31,8 @@ public:
    * Construct Two-Wire Interface (TWI).
    * @param[in] freq bus manager clock frequency (HZ).
    */
-  TWI(uint32_t freq = DEFAULT_FREQ)
+  TWI(uint32_t freq = DEFAULT_FREQ) :
+    m_tp(NULL)
   {
     // Initiate hardware registers: baudrate and control
     TWBR = ((F_CPU / freq) - 16) / 2;
@@ -47,26 +48,25 @@ public:
    */
   virtual bool acquire()
   {
-    // Acquire bus and issue start condition
-    lock();
+    // Issue start condition; recover bus on timeout
     m_start = true;
+    m_expired = false;
     TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTA);
-    return iowait(START);
+    if (iowait(START)) return (true);
+    if (m_expired) recover();
+    return (false);
   }
 
   /**
    * @override{TWI}
-   * Stop transaction. Mark the bus as available. Return true(1) if
-   * successful otherwise false(0).
+   * Stop transaction. Return true(1) if successful otherwise
+   * false(0).
    * @return bool.
    */
   virtual bool release()
   {
-    // Mark bus manager as idle
-    m_start = false;
-    unlock();
-
     // Issue stop condition and release bus
+    m_start = false;
     TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTO);
 
     // Allow the command to complete
@@ -76,67 +76,349 @@ public:
 
   /**
    * @override{TWI}
-   * Read data from device with given address into given buffer.
+   * Read data from device with given address into given io vector
+   * buffers. The read is retried with a start condition when
+   * arbitration is lost in the first phase of the transaction. In a
+   * later phase E_ARB_LOST is returned as the previous phases must
+   * also be repeated; see Retry.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes read or negative error code.
+   */
+  virtual int read(uint8_t addr, iovec_t* vp)
+  {
+    bool first = m_start;
+    int res;
+    m_expired = false;
+    for (uint8_t retry = 0;; retry++) {
+      res = receive(addr, vp);
+      if (res != E_ARB_LOST || !arbitration_lost(retry) || !first) break;
+      if (!restart()) {
+	res = error();
+	break;
+      }
+    }
+    if (res == E_TIMEOUT) recover();
+    return (res);
+  }
+
+  /**
+   * @override{TWI}
+   * Write data to device with from given io vector. The write is
+   * retried with a start condition when arbitration is lost in the
+   * first phase of the transaction. In a later phase E_ARB_LOST is
+   * returned as the previous phases must also be repeated; see
+   * Retry.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes written or negative error code.
+   */
+  virtual int write(uint8_t addr, iovec_t* vp)
+  {
+    bool first = m_start;
+    int res;
+    m_expired = false;
+    for (uint8_t retry = 0;; retry++) {
+      res = transmit(addr, vp);
+      if (res != E_ARB_LOST || !arbitration_lost(retry) || !first) break;
+      if (!restart()) {
+	res = error();
+	break;
+      }
+    }
+    if (res == E_TIMEOUT) recover();
+    return (res);
+  }
+
+  /**
+   * @override{TWI}
+   * Recover bus after transfer timeout. The hardware is disabled
+   * and the pins are used as open drain outputs to issue nine clock
+   * pulses and a stop condition. Return true(1) if the bus is free
+   * otherwise false(0).
+   * @return bool.
+   */
+  virtual bool recover()
+  {
+    // Disable hardware; release signals (external pullup resistors)
+    TWCR = 0;
+    m_start = false;
+    digitalWrite(SDA, LOW);
+    digitalWrite(SCL, LOW);
+    pinMode(SDA, INPUT);
+    pinMode(SCL, INPUT);
+
+    // Clock out any byte in progress
+    for (uint8_t i = 0; i < 9; i++) {
+      pinMode(SCL, OUTPUT);
+      delayMicroseconds(5);
+      pinMode(SCL, INPUT);
+      delayMicroseconds(5);
+    }
+
+    // Issue stop condition
+    pinMode(SCL, OUTPUT);
+    pinMode(SDA, OUTPUT);
+    delayMicroseconds(5);
+    pinMode(SCL, INPUT);
+    delayMicroseconds(5);
+    pinMode(SDA, INPUT);
+    delayMicroseconds(5);
+    return (digitalRead(SDA) && digitalRead(SCL));
+  }
+
+  /**
+   * Start given transaction. The transaction is performed in the
+   * background by the TWI interrupt service routine; isr(). Use
+   * await() or the transaction callback for completion. The
+   * sketch should forward the interrupt vector to the bus manager.
+   * @code
+   * ISR(TWI_vect) { twi.isr(); }
+   * @endcode
+   * Return true(1) if successful otherwise false(0).
+   * @param[in] tp transaction pointer.
+   * @return bool.
+   */
+  bool start(transaction_t* tp)
+  {
+    // Acquire bus; the lock is released on completion
+    lock();
+    tp->result = 0;
+    tp->completed = false;
+    begin(tp);
+    return (true);
+  }
+
+  /**
+   * @override{TWI}
+   * Dispatch queued transactions. Start the first transaction in
+   * the queue if the bus is idle. The interrupt service routine
+   * continues with the following transactions back-to-back using
+   * repeated start conditions.
+   */
+  virtual void dispatch()
+  {
+    uint8_t sreg = SREG;
+    cli();
+    if (m_put != m_get && try_lock()) begin(dequeue());
+    SREG = sreg;
+  }
+
+  /**
+   * @override{TWI}
+   * Check the current asynchronous transaction against the transfer
+   * timeout. An expired transaction is aborted; the bus is recovered
+   * and the transaction is completed with E_TIMEOUT.
+   */
+  virtual void watchdog()
+  {
+    uint8_t sreg = SREG;
+    cli();
+    if (m_tp != NULL && m_timeout != 0 && millis() - m_mark >= m_timeout) {
+      recover();
+      complete(E_TIMEOUT, false);
+    }
+    SREG = sreg;
+  }
+
+  /**
+   * Interrupt service routine; transaction state machine driven by
+   * the status codes. Should be called from the TWI interrupt vector.
+   */
+  void isr()
+  {
+    switch (TWSR & MASK) {
+    case START:
+    case REP_START:
+      // Address device with write or read request
+      TWDR = m_tp->addr | (m_writing ? 0x00 : 0x01);
+      TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWIE);
+      break;
+    case MT_SLA_ACK:
+    case MT_DATA_ACK:
+      // Write next byte from io vector
+      while (m_size == 0 && m_vp != NULL && m_vp->buf != NULL) {
+	m_bp = (uint8_t*) m_vp->buf;
+	m_size = m_vp->size;
+	m_vp++;
+      }
+      if (m_size != 0) {
+	TWDR = *m_bp++;
+	TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWIE);
+	m_size -= 1;
+	m_count += 1;
+	break;
+      }
+      // Write completed; check for read with repeated start condition
+      if (m_tp->count == 0) {
+	complete(m_count);
+	break;
+      }
+      m_writing = false;
+      m_bp = (uint8_t*) m_tp->buf;
+      m_size = m_tp->count;
+      m_count = 0;
+      TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTA) | _BV(TWIE);
+      break;
+    case MR_DATA_ACK:
+      *m_bp++ = TWDR;
+      m_size -= 1;
+      m_count += 1;
+      // Fall through
+    case MR_SLA_ACK:
+      // Read next byte; acknowledge until last byte
+      if (m_size > 1)
+	TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWEA) | _BV(TWIE);
+      else
+	TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWIE);
+      break;
+    case MR_DATA_NACK:
+      *m_bp++ = TWDR;
+      m_count += 1;
+      complete(m_count);
+      break;
+    case ARB_LOST:
+      // Bus released by hardware; retry transaction when bus is free
+      if (arbitration_lost(m_retry)) {
+	begin(m_tp, m_retry + 1);
+	break;
+      }
+      TWCR = _BV(TWEN) | _BV(TWINT);
+      complete(E_ARB_LOST, false);
+      break;
+    case MT_DATA_NACK:
+      m_acked = m_count - 1;
+      // Fall through
+    default:
+      complete(error());
+    }
+  }
+
+protected:
+  /** Status codes for Master Transmitter Mode. */
+  enum {
+    START = 0x08,		//!< Start condition transmitted.
+    REP_START = 0x10,		//!< Repeated start transmitted.
+    ARB_LOST = 0x38,		//!< Arbitration lost.
+    MT_SLA_ACK = 0x18,		//!< Slave address/write sent, ACK received.
+    MT_SLA_NACK = 0x20,		//!< dito, NACK received.
+    MT_DATA_ACK = 0x28,		//!< Data write sent, ACK received.
+    MT_DATA_NACK = 0x30,	//!< dito, NACK received.
+    MR_SLA_ACK = 0x40,		//!< Slave address/read sent, ACK received.
+    MR_SLA_NACK = 0x48,		//!< dito, NACK received.
+    MR_DATA_ACK = 0x50,		//!< Data received, ACK sent.
+    MR_DATA_NACK = 0x58,	//!< dito, NACK sent.
+    MASK = 0xF8,		//!< Mask status code.
+    BUS_ERROR = 0x00		//!< Bus error state.
+  } __attribute__((packed));
+
+
+  /**
+   * Wait for command to complete and check status. The wait is
+   * bounded by the transfer timeout. Return true(1) if correct
+   * status has been reached otherwise false(0).
+   * @param[in] status to be reached.
+   * @return bool.
+   */
+  bool iowait(uint8_t status)
+  {
+    uint32_t start = millis();
+    while (bit_is_clear(TWCR, TWINT)) {
+      if (m_timeout != 0 && millis() - start >= m_timeout) {
+	m_expired = true;
+	return (false);
+      }
+    }
+    return ((TWSR & MASK) == status);
+  }
+
+  /**
+   * Return error code for the last failed command; timeout or
+   * mapped from the status code.
+   * @return negative error code.
+   */
+  int error()
+  {
+    if (m_expired) return (E_TIMEOUT);
+    switch (TWSR & MASK) {
+    case MT_SLA_NACK:
+    case MR_SLA_NACK:
+      return (E_ADDR_NACK);
+    case MT_DATA_NACK:
+      return (E_DATA_NACK);
+    case ARB_LOST:
+      return (E_ARB_LOST);
+    default:
+      return (E_BUS_ERROR);
+    }
+  }
+
+  /**
+   * Read data from device with given address into given io vector
+   * buffers; single attempt.
    * @param[in] addr device address.
-   * @param[in] buf buffer pointer.
-   * @param[in] count buffer size in bytes.
+   * @param[in] vp io vector pointer.
    * @return number of bytes read or negative error code.
    */
-  virtual int read(uint8_t addr, void* buf, size_t count)
+  int receive(uint8_t addr, iovec_t* vp)
   {
     // Check if repeated start condition should be generated
     if (!m_start) {
       TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTA);
-      if (!iowait(REP_START)) return (false);
+      if (!iowait(REP_START)) return (error());
     }
     m_start = false;
 
     // Address device with read request and check that it acknowledges
     TWDR = addr | 0x01;
     TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWEA);
-    if (!iowait(MR_SLA_ACK)) return (-1);
-
-    // Read bytes and acknowledge until required size
-    uint8_t* bp = (uint8_t*) buf;
-    size_t size = count;
-    while (size--) {
-      if (size != 0) {
-	TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWEA);
-	if (!iowait(MR_DATA_ACK)) return (-1);
-      }
-      else {
-	TWCR = _BV(TWEN) | _BV(TWINT);
-	if (!iowait(MR_DATA_NACK)) return (-1);
+    if (!iowait(MR_SLA_ACK)) return (error());
+
+    // Read bytes into io vector buffers; acknowledge until last byte
+    size_t count = iovec_size(vp);
+    size_t left = count;
+    for(; vp->buf != NULL; vp++) {
+      uint8_t* bp = (uint8_t*) vp->buf;
+      size_t size = vp->size;
+      while (size--) {
+	if (--left != 0) {
+	  TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWEA);
+	  if (!iowait(MR_DATA_ACK)) return (error());
+	}
+	else {
+	  TWCR = _BV(TWEN) | _BV(TWINT);
+	  if (!iowait(MR_DATA_NACK)) return (error());
+	}
+	*bp++ = TWDR;
       }
-      *bp++ = TWDR;
     }
     return (count);
   }
 
   /**
-   * @override{TWI}
-   * Write data to device with from given io vector.
+   * Write data to device with from given io vector; single attempt.
    * @param[in] addr device address.
    * @param[in] vp io vector pointer.
    * @return number of bytes written or negative error code.
    */
-  virtual int write(uint8_t addr, iovec_t* vp)
+  int transmit(uint8_t addr, iovec_t* vp)
   {
     // Check if repeated start condition should be generated
     if (!m_start) {
       TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTA);
-      if (!iowait(REP_START)) return (-1);
+      if (!iowait(REP_START)) return (error());
     }
     m_start = false;
 
     // Address device with write request and check that it acknowledges
     TWDR = addr | 0x00;
     TWCR = _BV(TWEN) | _BV(TWINT);
-    if (!iowait(MT_SLA_ACK)) return (-1);
+    if (!iowait(MT_SLA_ACK)) return (error());
     if (vp == NULL) return (0);
 
     // Write given io vector buffers to device
     int count = 0;
+    m_acked = 0;
     for(; vp->buf != NULL; vp++) {
       const uint8_t* bp = (const uint8_t*) vp->buf;
       size_t size = vp->size;
@@ -144,45 +426,99 @@ public:
       while (size--) {
 	TWDR = *bp++;
 	TWCR = _BV(TWEN) | _BV(TWINT);
-	if (!iowait(MT_DATA_ACK)) return (-1);
+	if (!iowait(MT_DATA_ACK)) return (error());
+	m_acked += 1;
       }
     }
     return (count);
   }
 
-protected:
-  /** Status codes for Master Transmitter Mode. */
-  enum {
-    START = 0x08,		//!< Start condition transmitted.
-    REP_START = 0x10,		//!< Repeated start transmitted.
-    ARB_LOST = 0x38,		//!< Arbitration lost.
-    MT_SLA_ACK = 0x18,		//!< Slave address/write sent, ACK received.
-    MT_SLA_NACK = 0x20,		//!< dito, NACK received.
-    MT_DATA_ACK = 0x28,		//!< Data write sent, ACK received.
-    MT_DATA_NACK = 0x30,	//!< dito, NACK received.
-    MR_SLA_ACK = 0x40,		//!< Slave address/read sent, ACK received.
-    MR_SLA_NACK = 0x48,		//!< dito, NACK received.
-    MR_DATA_ACK = 0x50,		//!< Data received, ACK sent.
-    MR_DATA_NACK = 0x58,	//!< dito, NACK sent.
-    MASK = 0xF8,		//!< Mask status code.
-    BUS_ERROR = 0x00		//!< Bus error state.
-  } __attribute__((packed));
+  /**
+   * Issue start condition after arbitration loss. The hardware
+   * waits for the bus to be free. Return true(1) if successful
+   * otherwise false(0).
+   * @return bool.
+   */
+  bool restart()
+  {
+    m_start = true;
+    TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTA);
+    return (iowait(START));
+  }
 
+  /**
+   * Initiate state machine for given transaction and issue start
+   * condition. The bus should be locked by the caller.
+   * @param[in] tp transaction pointer.
+   * @param[in] retry number of retries after arbitration loss
+   * (default 0).
+   */
+  void begin(transaction_t* tp, uint8_t retry = 0)
+  {
+    m_tp = tp;
+    m_retry = retry;
+    m_mark = millis();
+    m_expired = false;
+    m_writing = (tp->vp != NULL) || (tp->count == 0);
+    m_vp = tp->vp;
+    m_bp = (uint8_t*) tp->buf;
+    m_size = m_writing ? 0 : tp->count;
+    m_count = 0;
+    TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTA) | _BV(TWIE);
+  }
 
   /**
-   * Wait for command to complete and check status. Return true(1)
-   * if correct status has been reached otherwise false(0).
-   * @param[in] status to be reached.
-   * @return bool.
+   * Complete current transaction with given result and call the
+   * transaction callback. Continue with the next queued transaction
+   * with a repeated start condition, otherwise issue stop condition
+   * and release bus.
+   * @param[in] res number of bytes or negative error code.
+   * @param[in] stop issue stop condition (default true).
    */
-  bool iowait(uint8_t status)
+  void complete(int res, bool stop = true)
   {
-    loop_until_bit_is_set(TWCR, TWINT);
-    return ((TWSR & MASK) == status);
+    transaction_t* tp = m_tp;
+    transaction_t* next = dequeue();
+    if (next != NULL) {
+      begin(next);
+    }
+    else {
+      if (stop) TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTO);
+      m_tp = NULL;
+      unlock();
+    }
+    notify(tp, res);
   }
 
   /** Start condition issued flag. */
   bool m_start;
+
+  /** Transfer timeout expired. */
+  bool m_expired;
+
+  /** Current asynchronous transaction. */
+  transaction_t* volatile m_tp;
+
+  /** Write phase of current transaction. */
+  bool m_writing;
+
+  /** Current io vector segment (write phase). */
+  iovec_t* m_vp;
+
+  /** Current buffer pointer. */
+  uint8_t* m_bp;
+
+  /** Remaining bytes in current buffer. */
+  size_t m_size;
+
+  /** Number of bytes transferred in current phase. */
+  int m_count;
+
+  /** Number of retries of current transaction after arbitration loss. */
+  uint8_t m_retry;
+
+  /** Start of current transaction (ms); transfer timeout. */
+  uint32_t m_mark;
 };
 };
 
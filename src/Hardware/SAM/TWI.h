@@ -24,30 +24,68 @@
 #include "variant.h"
 
 /**
- * Hardware Two-Wire Interface (TWI) class.
+ * Hardware Two-Wire Interface (TWI) class. The Arduino Due has two
+ * controllers; Wire (TWI1, pins SDA/SCL) and Wire1 (TWI0, pins
+ * SDA1/SCL1). Each bus manager instance drives one controller and
+ * the instances may transfer concurrently.
  */
 namespace Hardware {
 class TWI : public ::TWI {
 public:
+  /** Controller instances. */
+  enum {
+    WIRE = 0,			//!< Wire; TWI1, pins SDA/SCL.
+    WIRE1 = 1			//!< Wire1; TWI0, pins SDA1/SCL1.
+  };
+
   /**
-   * Construct Two-Wire Interface (TWI).
+   * Construct Two-Wire Interface (TWI) for given controller.
+   * Asynchronous transactions on the Wire1 controller require the
+   * sketch to forward WIRE1_ISR_HANDLER to isr().
    * @param[in] freq bus manager clock frequency (HZ).
+   * @param[in] bus controller instance (default WIRE).
    */
-  TWI(uint32_t freq = DEFAULT_FREQ) :
-    m_state(IDLE_STATE)
+  TWI(uint32_t freq = DEFAULT_FREQ, uint8_t bus = WIRE) :
+    m_freq(freq),
+    m_state(IDLE_STATE),
+    m_pdc_min(PDC_MIN),
+    m_tp(NULL)
   {
+    uint32_t id;
+#if WIRE_INTERFACES_COUNT > 1
+    if (bus == WIRE1) {
+      m_twi = WIRE1_INTERFACE;
+      m_irq = WIRE1_ISR_ID;
+      id = WIRE1_INTERFACE_ID;
+      m_sda = PIN_WIRE1_SDA;
+      m_scl = PIN_WIRE1_SCL;
+    }
+    else
+#endif
+    {
+      m_twi = WIRE_INTERFACE;
+      m_irq = WIRE_ISR_ID;
+      id = WIRE_INTERFACE_ID;
+      m_sda = PIN_WIRE_SDA;
+      m_scl = PIN_WIRE_SCL;
+    }
+
     // Initiate hardware registers
-    pmc_enable_periph_clk(WIRE_INTERFACE_ID);
-    PIO_Configure(g_APinDescription[PIN_WIRE_SDA].pPort,
-		  g_APinDescription[PIN_WIRE_SDA].ulPinType,
-		  g_APinDescription[PIN_WIRE_SDA].ulPin,
-		  g_APinDescription[PIN_WIRE_SDA].ulPinConfiguration);
-    PIO_Configure(g_APinDescription[PIN_WIRE_SCL].pPort,
-		  g_APinDescription[PIN_WIRE_SCL].ulPinType,
-		  g_APinDescription[PIN_WIRE_SCL].ulPin,
-		  g_APinDescription[PIN_WIRE_SCL].ulPinConfiguration);
-    m_twi = WIRE_INTERFACE;
-    TWI_ConfigureMaster(m_twi, freq, VARIANT_MCK);
+    pmc_enable_periph_clk(id);
+    configure();
+    NVIC_ClearPendingIRQ(m_irq);
+    NVIC_EnableIRQ(m_irq);
+  }
+
+  /**
+   * Set minimum number of bytes for transfers with the Peripheral
+   * DMA Controller (PDC). Shorter io vector buffers and reads are
+   * transferred byte by byte. Zero(0) disables PDC transfers.
+   * @param[in] size minimum number of bytes (default PDC_MIN).
+   */
+  void pdc_threshold(size_t size = PDC_MIN)
+  {
+    m_pdc_min = size;
   }
 
   /**
@@ -58,16 +96,15 @@ public:
    */
   virtual bool acquire()
   {
-    // Wait for bus manager to become idle
-    lock();
     m_state = BUSY_STATE;
+    m_first = true;
     return (true);
   }
 
   /**
    * @override{TWI}
-   * Stop transaction. Mark the bus as available. Return true(1) if
-   * successful otherwise false(0).
+   * Stop transaction. Return true(1) if successful otherwise
+   * false(0).
    * @return bool.
    */
   virtual bool release()
@@ -75,66 +112,531 @@ public:
     bool res = true;
 
     // Check for terminating write sequence with stop condition
-    if (m_state == WRITE_STATE) res = stop_condition();
+    if (m_state == WRITE_STATE) {
+      int err = stop_condition(true);
+      if (err == E_TIMEOUT) recover();
+      res = (err == 0);
+    }
 
     // Mark bus manager as idle
-    unlock();
     m_state = IDLE_STATE;
     return (res);
   }
 
   /**
    * @override{TWI}
-   * Read data from device with given address into given buffer.
+   * Read data from device with given address into given io vector
+   * buffers. The read is retried when arbitration is lost in the
+   * first phase of the transaction. In a later phase E_ARB_LOST is
+   * returned as the previous phases must also be repeated; see
+   * Retry.
    * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes read or negative error code.
+   */
+  virtual int read(uint8_t addr, iovec_t* vp)
+  {
+    // Check if stop condition is needed before read
+    bool first = m_first;
+    int res = 0;
+    if (m_state == WRITE_STATE) res = stop_condition(true);
+
+    // Read requested bytes from device
+    if (res == 0) {
+      for (uint8_t retry = 0;; retry++) {
+	res = receive(((addr >> 1) << 16) | TWI_MMR_MREAD, vp);
+	if (!is_retry(res, first, retry)) break;
+      }
+    }
+    m_first = false;
+    if (res == E_TIMEOUT) recover();
+    return (res);
+  }
+
+  /**
+   * @override{TWI}
+   * Write data to device with given address from given io vector
+   * and read response into given buffer. Writes of one to three
+   * bytes are issued through the internal address register so that
+   * the controller generates a repeated start condition.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
    * @param[in] buf buffer pointer.
    * @param[in] count buffer size in bytes.
    * @return number of bytes read or negative error code.
    */
-  virtual int read(uint8_t addr, void* buf, size_t count)
+  virtual int write_read(uint8_t addr, iovec_t* vp, void* buf, size_t count)
   {
-    // Ignore zero length read
-    if (count == 0) return (0);
-    uint32_t retry;
+    // Collect internal address from io vector (big-endian)
+    uint32_t iadr = 0;
+    size_t size = 0;
+    for (iovec_t* ip = vp; ip != NULL && ip->buf != NULL; ip++) {
+      const uint8_t* bp = (const uint8_t*) ip->buf;
+      for (size_t i = 0; i < ip->size; i++) iadr = (iadr << 8) | *bp++;
+      size += ip->size;
+    }
 
-    // Check if stop condition is needed before read
-    if (m_state == WRITE_STATE && !stop_condition()) return (-1);
+    // Fallback to write followed by read
+    if (size == 0 || size > 3 || count == 0) {
+      int res = TWI::write(addr, vp);
+      if (res < 0) return (res);
+      return (::TWI::read(addr, buf, count));
+    }
 
-    // Adjust address
-    addr >>= 1;
+    // Read requested bytes from device with internal address
+    return (TWI::read_register(addr, iadr, size, buf, count));
+  }
 
-    // Read requested bytes from device
-    uint8_t* bp = (uint8_t*) buf;
+  /**
+   * @override{TWI}
+   * Read register with given internal address from device with
+   * given address into given buffer. The internal address register
+   * is used so that the controller generates the repeated start
+   * condition.
+   * @param[in] addr device address.
+   * @param[in] reg internal register address.
+   * @param[in] size internal address size in bytes (1..3).
+   * @param[in] buf buffer pointer.
+   * @param[in] count buffer size in bytes.
+   * @return number of bytes read or negative error code.
+   */
+  virtual int read_register(uint8_t addr, uint32_t reg, uint8_t size,
+			    void* buf, size_t count)
+  {
+    // Fallback to write followed by read
+    if (size == 0 || size > 3 || count == 0)
+      return (::TWI::read_register(addr, reg, size, buf, count));
+
+    // Check if stop condition is needed before read
+    bool first = m_first;
     int res = 0;
-    m_twi->TWI_MMR = (addr << 16) | TWI_MMR_MREAD;
-    m_twi->TWI_CR = TWI_CR_START;
-    while (count--) {
-      if (count == 0) m_twi->TWI_CR |= TWI_CR_STOP;
-      retry = RETRY_MAX;
-      while (((m_twi->TWI_SR & TWI_SR_RXRDY) == 0) && (--retry));
-      if (retry == 0) return (-1);
-      *bp++ = m_twi->TWI_RHR;
-      res += 1;
-    }
-    retry = RETRY_MAX;
-    while (((m_twi->TWI_SR & TWI_SR_TXCOMP) == 0) && (--retry));
-    if (retry == 0) return (-1);
+    if (m_state == WRITE_STATE) res = stop_condition(true);
 
-    // Return number of bytes read
+    // Read requested bytes from device with internal address
+    if (res == 0) {
+      iovec_t vec[2];
+      iovec_t* vp = vec;
+      iovec_arg(vp, buf, count);
+      iovec_end(vp);
+      m_twi->TWI_IADR = reg;
+      for (uint8_t retry = 0;; retry++) {
+	res = receive(((addr >> 1) << 16)
+		      | TWI_MMR_MREAD
+		      | (size << TWI_MMR_IADRSZ_Pos),
+		      vec);
+	if (!is_retry(res, first, retry)) break;
+      }
+    }
+    m_first = false;
+    if (res == E_TIMEOUT) recover();
     return (res);
   }
 
   /**
    * @override{TWI}
-   * Write data to device with from given io vector.
+   * Write data to device with from given io vector. The write is
+   * retried when arbitration is lost in the first phase of the
+   * transaction. In a later phase E_ARB_LOST is returned as the
+   * previous phases must also be repeated; see Retry.
    * @param[in] addr device address.
    * @param[in] vp io vector pointer.
    * @return number of bytes written or negative error code.
    */
   virtual int write(uint8_t addr, iovec_t* vp)
   {
-    uint32_t retry;
+    bool first = m_first;
+    int res;
+    for (uint8_t retry = 0;; retry++) {
+      res = transmit(addr, vp);
+      if (!is_retry(res, first, retry)) break;
+    }
+    m_first = false;
+    if (res == E_TIMEOUT) recover();
+    return (res);
+  }
+
+  /**
+   * @override{TWI}
+   * Recover bus after transfer timeout. The pins are used as open
+   * drain outputs (PIO) to issue nine clock pulses and a stop
+   * condition. The controller is then reinitiated. Return true(1) if
+   * the bus is free otherwise false(0).
+   * @return bool.
+   */
+  virtual bool recover()
+  {
+    // Disable controller; release signals (external pullup resistors)
+    const PinDescription& sda = g_APinDescription[m_sda];
+    const PinDescription& scl = g_APinDescription[m_scl];
+    m_twi->TWI_IDR = 0xffffffff;
+    m_twi->TWI_PTCR = TWI_PTCR_RXTDIS | TWI_PTCR_TXTDIS;
+    PIO_Configure(sda.pPort, PIO_INPUT, sda.ulPin, PIO_DEFAULT);
+    PIO_Configure(scl.pPort, PIO_INPUT, scl.ulPin, PIO_DEFAULT);
+
+    // Clock out any byte in progress
+    for (uint8_t i = 0; i < 9; i++) {
+      PIO_Configure(scl.pPort, PIO_OUTPUT_0, scl.ulPin, PIO_DEFAULT);
+      delayMicroseconds(5);
+      PIO_Configure(scl.pPort, PIO_INPUT, scl.ulPin, PIO_DEFAULT);
+      delayMicroseconds(5);
+    }
+
+    // Issue stop condition
+    PIO_Configure(scl.pPort, PIO_OUTPUT_0, scl.ulPin, PIO_DEFAULT);
+    PIO_Configure(sda.pPort, PIO_OUTPUT_0, sda.ulPin, PIO_DEFAULT);
+    delayMicroseconds(5);
+    PIO_Configure(scl.pPort, PIO_INPUT, scl.ulPin, PIO_DEFAULT);
+    delayMicroseconds(5);
+    PIO_Configure(sda.pPort, PIO_INPUT, sda.ulPin, PIO_DEFAULT);
+    delayMicroseconds(5);
+    bool res = (PIO_Get(sda.pPort, PIO_INPUT, sda.ulPin)
+		&& PIO_Get(scl.pPort, PIO_INPUT, scl.ulPin));
+
+    // Reinitiate controller; the write sequence was terminated
+    configure();
+    if (m_state == WRITE_STATE) m_state = BUSY_STATE;
+    return (res);
+  }
+
+  /**
+   * Start given transaction. The transaction is performed in the
+   * background by the TWI interrupt handler; isr(). Use await()
+   * or the transaction callback for completion. The transaction is
+   * bounded by the transfer timeout; see watchdog(). The sketch
+   * should forward the interrupt handler to the bus manager (and not
+   * link the Wire library).
+   * @code
+   * void WIRE_ISR_HANDLER() { twi.isr(); }
+   * void WIRE1_ISR_HANDLER() { twi1.isr(); }
+   * @endcode
+   * Return true(1) if successful otherwise false(0).
+   * @param[in] tp transaction pointer.
+   * @return bool.
+   */
+  bool start(transaction_t* tp)
+  {
+    // Acquire bus; the lock is released on completion
+    lock();
+    tp->result = 0;
+    tp->completed = false;
+    begin(tp);
+    return (true);
+  }
+
+  /**
+   * @override{TWI}
+   * Dispatch queued transactions. Start the first transaction in
+   * the queue if the bus is idle. The interrupt handler continues
+   * with the following transactions.
+   */
+  virtual void dispatch()
+  {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (m_put != m_get && try_lock()) begin(dequeue());
+    __set_PRIMASK(primask);
+  }
+
+  /**
+   * @override{TWI}
+   * Check the current asynchronous transaction against the transfer
+   * timeout. An expired transaction is aborted; the bus is recovered
+   * and the transaction is completed with E_TIMEOUT.
+   */
+  virtual void watchdog()
+  {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (m_tp != NULL && m_timeout != 0 && millis() - m_mark >= m_timeout) {
+      recover();
+      complete(E_TIMEOUT, false);
+    }
+    __set_PRIMASK(primask);
+  }
+
+  /**
+   * Interrupt service routine; transaction state machine driven by
+   * the enabled status flags. Should be called from the TWI
+   * interrupt handler.
+   */
+  void isr()
+  {
+    uint32_t sr = m_twi->TWI_SR & m_twi->TWI_IMR;
+
+    // Bus released by hardware; retry transaction when bus is free
+    if (sr & TWI_SR_ARBLST) {
+      if (arbitration_lost(m_retry)) {
+	m_twi->TWI_IDR = 0xffffffff;
+	m_twi->TWI_PTCR = TWI_PTCR_RXTDIS | TWI_PTCR_TXTDIS;
+	begin(m_tp, m_retry + 1);
+	return;
+      }
+      complete(E_ARB_LOST, false);
+      return;
+    }
+
+    // Check for address or data not acknowledged; the address has
+    // been acknowledged when the second byte is transferred
+    if (sr & TWI_SR_NACK) {
+      size_t left = (m_twi->TWI_IMR & TWI_IMR_ENDTX) ? m_twi->TWI_TCR : 0;
+      size_t taken = m_count - left;
+      if (taken > 1) m_addressed = true;
+      bool data = m_writing && m_addressed;
+      if (data) m_acked = taken - 1;
+      complete(error(sr, data));
+      return;
+    }
+
+    // Large buffer written by PDC; continue with next buffer
+    if (sr & TWI_SR_ENDTX) {
+      m_addressed = true;
+      m_twi->TWI_PTCR = TWI_PTCR_TXTDIS;
+      m_twi->TWI_IDR = TWI_IDR_ENDTX;
+      m_twi->TWI_IER = TWI_IER_TXRDY;
+      return;
+    }
+
+    // Large read by PDC; receive the last two bytes
+    if (sr & TWI_SR_ENDRX) {
+      m_twi->TWI_PTCR = TWI_PTCR_RXTDIS;
+      m_bp += m_size - 2;
+      m_count += m_size - 2;
+      m_size = 2;
+      m_twi->TWI_IDR = TWI_IDR_ENDRX;
+      m_twi->TWI_IER = TWI_IER_RXRDY;
+      return;
+    }
+
+    // Write next byte from io vector; stop after last byte
+    if (sr & TWI_SR_TXRDY) {
+      if (m_count != 0) m_addressed = true;
+      while (m_size == 0 && m_vp != NULL && m_vp->buf != NULL) {
+	m_bp = (uint8_t*) m_vp->buf;
+	m_size = m_vp->size;
+	m_vp++;
+      }
+      if (is_pdc(m_size)) {
+	m_twi->TWI_TPR = (uint32_t) (uintptr_t) m_bp;
+	m_twi->TWI_TCR = m_size;
+	m_count += m_size;
+	m_size = 0;
+	m_twi->TWI_IDR = TWI_IDR_TXRDY;
+	m_twi->TWI_IER = TWI_IER_ENDTX;
+	m_twi->TWI_PTCR = TWI_PTCR_TXTEN;
+      }
+      else if (m_size != 0) {
+	m_twi->TWI_THR = *m_bp++;
+	m_size -= 1;
+	m_count += 1;
+      }
+      else {
+	m_twi->TWI_CR = TWI_CR_STOP;
+	m_twi->TWI_IDR = TWI_IDR_TXRDY;
+	m_twi->TWI_IER = TWI_IER_TXCOMP;
+      }
+      return;
+    }
+
+    // Read next byte; stop before last byte
+    if (sr & TWI_SR_RXRDY) {
+      *m_bp++ = m_twi->TWI_RHR;
+      m_count += 1;
+      if (--m_size == 1) m_twi->TWI_CR = TWI_CR_STOP;
+      if (m_size == 0) {
+	m_twi->TWI_IDR = TWI_IDR_RXRDY;
+	m_twi->TWI_IER = TWI_IER_TXCOMP;
+      }
+      return;
+    }
+
+    // Transfer completed; continue with read phase if needed
+    if (sr & TWI_SR_TXCOMP) {
+      if (m_writing && m_tp->count != 0) {
+	receive(0);
+	return;
+      }
+      complete(m_count);
+    }
+  }
+
+protected:
+  /** Default minimum number of bytes for PDC transfers. */
+  static const size_t PDC_MIN = 16;
+
+  /** TWI instance (libsam/twi). */
+  Twi* m_twi;
+
+  /** Bus clock frequency (Hz). */
+  uint32_t m_freq;
+
+  /** Data signal pin. */
+  uint8_t m_sda;
+
+  /** Clock signal pin. */
+  uint8_t m_scl;
+
+  /** TWI interrupt number. */
+  IRQn_Type m_irq;
+
+  /** Device driver states. */
+  enum state_t {
+    IDLE_STATE,
+    BUSY_STATE,
+    WRITE_STATE
+  };
+  state_t m_state;
+
+  /** Minimum number of bytes for PDC transfers; zero to disable. */
+  size_t m_pdc_min;
+
+  /** Current asynchronous transaction. */
+  transaction_t* volatile m_tp;
+
+  /** Write phase of current transaction. */
+  bool m_writing;
+
+  /** Current io vector segment (write phase). */
+  iovec_t* m_vp;
 
+  /** Current buffer pointer. */
+  uint8_t* m_bp;
+
+  /** Remaining bytes in current buffer. */
+  size_t m_size;
+
+  /** Number of bytes transferred in current phase. */
+  int m_count;
+
+  /** Address acknowledged in current phase. */
+  bool m_addressed;
+
+  /** Start of current transaction (ms); transfer timeout. */
+  uint32_t m_mark;
+
+  /** Number of retries of current transaction after arbitration loss. */
+  uint8_t m_retry;
+
+  /** First phase of blocking transaction; retried on arbitration loss. */
+  bool m_first;
+
+  /**
+   * Initiate state machine for given transaction. Writes of one to
+   * three bytes followed by a read are issued through the internal
+   * address register with repeated start condition. Otherwise the
+   * write is terminated with a stop condition before the read. The
+   * bus should be locked by the caller.
+   * @param[in] tp transaction pointer.
+   * @param[in] retry number of retries after arbitration loss
+   * (default 0).
+   */
+  void begin(transaction_t* tp, uint8_t retry = 0)
+  {
+    m_tp = tp;
+    m_retry = retry;
+    m_mark = millis();
+    m_count = 0;
+    m_addressed = false;
+
+    // Address only write (probe); send single data byte and stop
+    if (tp->vp == NULL && tp->count == 0) {
+      m_writing = true;
+      m_vp = NULL;
+      m_size = 0;
+      m_twi->TWI_MMR = (tp->addr >> 1) << 16;
+      m_twi->TWI_THR = 0;
+      m_twi->TWI_CR = TWI_CR_STOP;
+      m_twi->TWI_IER = TWI_IER_TXCOMP | TWI_IER_NACK | TWI_IER_ARBLST;
+      return;
+    }
+
+    // Check for read only or internal address
+    size_t size = iovec_size(tp->vp);
+    if (tp->count != 0 && size <= 3) {
+      uint32_t iadr = 0;
+      for (iovec_t* vp = tp->vp; vp != NULL && vp->buf != NULL; vp++) {
+	const uint8_t* bp = (const uint8_t*) vp->buf;
+	for (size_t i = 0; i < vp->size; i++) iadr = (iadr << 8) | *bp++;
+      }
+      m_writing = false;
+      m_twi->TWI_IADR = iadr;
+      receive(size << TWI_MMR_IADRSZ_Pos);
+      return;
+    }
+
+    // Write io vector buffers; first byte starts the transfer
+    m_writing = true;
+    m_vp = tp->vp;
+    m_size = 0;
+    m_twi->TWI_MMR = (tp->addr >> 1) << 16;
+    m_twi->TWI_IER = TWI_IER_TXRDY | TWI_IER_NACK | TWI_IER_ARBLST;
+  }
+
+  /**
+   * Start read phase of current transaction with given internal
+   * address size setting.
+   * @param[in] iadrsz internal address size field of mode register.
+   */
+  void receive(uint32_t iadrsz)
+  {
+    m_writing = false;
+    m_bp = (uint8_t*) m_tp->buf;
+    m_size = m_tp->count;
+    m_count = 0;
+    m_addressed = false;
+    m_twi->TWI_IDR = 0xffffffff;
+    m_twi->TWI_MMR = ((m_tp->addr >> 1) << 16) | TWI_MMR_MREAD | iadrsz;
+
+    // Large read by PDC except the last two bytes
+    if (m_size > 2 && is_pdc(m_size - 2)) {
+      m_twi->TWI_RPR = (uint32_t) (uintptr_t) m_bp;
+      m_twi->TWI_RCR = m_size - 2;
+      m_twi->TWI_PTCR = TWI_PTCR_RXTEN;
+      m_twi->TWI_CR = TWI_CR_START;
+      m_twi->TWI_IER = TWI_IER_ENDRX | TWI_IER_NACK | TWI_IER_ARBLST;
+      return;
+    }
+    if (m_size == 1)
+      m_twi->TWI_CR = TWI_CR_START | TWI_CR_STOP;
+    else
+      m_twi->TWI_CR = TWI_CR_START;
+    m_twi->TWI_IER = TWI_IER_RXRDY | TWI_IER_NACK | TWI_IER_ARBLST;
+  }
+
+  /**
+   * Complete current transaction with given result and call the
+   * transaction callback. Continue with the next queued transaction,
+   * otherwise release bus.
+   * @param[in] res number of bytes or negative error code.
+   * @param[in] stop issue stop condition on error (default true).
+   */
+  void complete(int res, bool stop = true)
+  {
+    transaction_t* tp = m_tp;
+    m_twi->TWI_IDR = 0xffffffff;
+    m_twi->TWI_PTCR = TWI_PTCR_RXTDIS | TWI_PTCR_TXTDIS;
+    if (res < 0 && stop) {
+      m_twi->TWI_CR = TWI_CR_STOP;
+      (void) m_twi->TWI_RHR;
+    }
+    transaction_t* next = dequeue();
+    if (next != NULL) {
+      begin(next);
+    }
+    else {
+      m_tp = NULL;
+      unlock();
+    }
+    notify(tp, res);
+  }
+
+  /**
+   * Write data to device with from given io vector; single attempt.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes written or negative error code.
+   */
+  int transmit(uint8_t addr, iovec_t* vp)
+  {
     // Adjust address
     addr >>= 1;
 
@@ -142,25 +644,41 @@ public:
     if (vp == NULL) {
       m_twi->TWI_MMR = (addr << 16);
       m_twi->TWI_THR = 0;
-      if (!stop_condition()) return (-1);
-      return (0);
+      return (stop_condition(false));
     }
 
     // Check for preceeding write state
-    if (m_state != WRITE_STATE) m_twi->TWI_MMR = (addr << 16);
+    if (m_state != WRITE_STATE) {
+      m_twi->TWI_MMR = (addr << 16);
+      m_addressed = false;
+    }
     m_state = WRITE_STATE;
     int res = 0;
 
-    // Write buffer sequence to the device
+    // Write buffer sequence to the device; large buffers with PDC
     for(; vp->buf != NULL; vp++) {
       const uint8_t* bp = (const uint8_t*) vp->buf;
       size_t size = vp->size;
+      if (is_pdc(size)) {
+	int err = pdc_write(bp, size);
+	if (err < 0) {
+	  size_t taken = size - m_twi->TWI_TCR;
+	  m_acked = res + (taken != 0 ? taken - 1 : 0);
+	  return (err);
+	}
+	res += size;
+	continue;
+      }
       while (size--) {
 	m_twi->TWI_THR = *bp++;
+	uint32_t sr = iowait(TWI_SR_TXRDY);
+	if (sr == 0) return (E_TIMEOUT);
+	if (sr & (TWI_SR_NACK | TWI_SR_ARBLST)) {
+	  m_acked = res;
+	  return (error(sr, m_addressed));
+	}
+	m_addressed = true;
 	res += 1;
-	retry = RETRY_MAX;
-	while ((m_twi->TWI_SR & TWI_SR_TXRDY) == 0)
-	  if (--retry == 0) return (-1);
       }
     }
     // Do not terminate with a stop condition. Additional
@@ -169,34 +687,243 @@ public:
     return (res);
   }
 
-protected:
-  /** Maximum number of retries. */
-  static const uint32_t RETRY_MAX = 100000;
+  /**
+   * Read data from device with given mode register setting into
+   * given io vector buffers. Return number of bytes read or negative
+   * error code.
+   * @param[in] mmr master mode register value.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes read or negative error code.
+   */
+  int receive(uint32_t mmr, iovec_t* vp)
+  {
+    // Ignore zero length read
+    size_t count = iovec_size(vp);
+    if (count == 0) return (0);
+    uint32_t sr;
 
-  /** TWI instance (libsam/twi). */
-  Twi* m_twi;
+    // Read requested bytes from device; stop before the last byte.
+    // Large buffers are read with PDC except the last two bytes
+    int res = 0;
+    m_twi->TWI_MMR = mmr;
+    m_twi->TWI_CR = TWI_CR_START;
+    m_addressed = false;
+    for(; vp->buf != NULL; vp++) {
+      uint8_t* bp = (uint8_t*) vp->buf;
+      size_t size = vp->size;
+      size_t n = (count > size + 2) ? size : (count > 2 ? count - 2 : 0);
+      if (is_pdc(n)) {
+	int err = pdc_read(bp, n);
+	if (err < 0) return (err);
+	bp += n;
+	size -= n;
+	count -= n;
+	res += n;
+      }
+      while (size--) {
+	if (--count == 0) m_twi->TWI_CR |= TWI_CR_STOP;
+	sr = iowait(TWI_SR_RXRDY);
+	if (sr == 0) return (E_TIMEOUT);
+	if ((sr & TWI_SR_RXRDY) == 0) return (error(sr, false));
+	*bp++ = m_twi->TWI_RHR;
+	res += 1;
+      }
+    }
+    sr = iowait(TWI_SR_TXCOMP);
+    if (sr == 0) return (E_TIMEOUT);
+    if ((sr & TWI_SR_TXCOMP) == 0) return (error(sr, false));
 
-  /** Device driver states. */
-  enum state_t {
-    IDLE_STATE,
-    BUSY_STATE,
-    WRITE_STATE
-  };
-  state_t m_state;
+    // Return number of bytes read
+    return (res);
+  }
 
-  bool stop_condition()
+  /**
+   * Return true(1) if a transfer of given number of bytes should use
+   * PDC otherwise false(0).
+   * @param[in] size number of bytes.
+   * @return bool.
+   */
+  bool is_pdc(size_t size) const
+  {
+    return ((m_pdc_min != 0) && (size != 0) && (size >= m_pdc_min));
+  }
+
+  /**
+   * Return error code for given status register value; not
+   * acknowledged, arbitration lost or timeout. The controller does
+   * not separate address and first data byte not acknowledged; data
+   * should be true if data bytes have been acknowledged.
+   * @param[in] sr status register value.
+   * @param[in] data data bytes acknowledged.
+   * @return error code.
+   */
+  static int error(uint32_t sr, bool data)
+  {
+    if (sr & TWI_SR_NACK) return (data ? E_DATA_NACK : E_ADDR_NACK);
+    if (sr & TWI_SR_ARBLST) return (E_ARB_LOST);
+    return (E_TIMEOUT);
+  }
+
+  /**
+   * Wait for given PDC end of transfer flag. The timeout is restarted
+   * while the given transfer counter makes progress. The address has
+   * been acknowledged when the second byte is transferred. Return
+   * zero(0) if successful otherwise negative error code.
+   * @param[in] flag status register end of transfer flag.
+   * @param[in] counter PDC transfer counter register.
+   * @return zero or negative error code.
+   */
+  int pdc_await(uint32_t flag, volatile uint32_t& counter)
   {
+    uint32_t start = micros();
+    uint32_t size = counter;
+    uint32_t left = size;
     uint32_t sr;
-    uint32_t retry = RETRY_MAX;
+    while (((sr = m_twi->TWI_SR) & flag) == 0) {
+      if (counter + 1 < size) m_addressed = true;
+      if (sr & (TWI_SR_NACK | TWI_SR_ARBLST))
+	return (error(sr, m_addressed));
+      if (counter != left) {
+	left = counter;
+	start = micros();
+      }
+      else if (is_expired(start)) return (E_TIMEOUT);
+    }
+    m_addressed = true;
+    if (sr & (TWI_SR_NACK | TWI_SR_ARBLST)) return (error(sr, true));
+    return (0);
+  }
+
+  /**
+   * Write given buffer with PDC and wait for the last byte to be
+   * transferred to the shift register. Return zero(0) if successful
+   * otherwise negative error code.
+   * @param[in] buf buffer pointer.
+   * @param[in] size number of bytes.
+   * @return zero or negative error code.
+   */
+  int pdc_write(const uint8_t* buf, size_t size)
+  {
+    m_twi->TWI_TPR = (uint32_t) (uintptr_t) buf;
+    m_twi->TWI_TCR = size;
+    m_twi->TWI_PTCR = TWI_PTCR_TXTEN;
+    int res = pdc_await(TWI_SR_ENDTX, m_twi->TWI_TCR);
+    m_twi->TWI_PTCR = TWI_PTCR_TXTDIS;
+    if (res < 0) return (res);
+    uint32_t sr = iowait(TWI_SR_TXRDY);
+    if (sr == 0) return (E_TIMEOUT);
+    if (sr & (TWI_SR_NACK | TWI_SR_ARBLST)) return (error(sr, true));
+    return (0);
+  }
+
+  /**
+   * Read into given buffer with PDC. Return zero(0) if successful
+   * otherwise negative error code.
+   * @param[in] buf buffer pointer.
+   * @param[in] size number of bytes.
+   * @return zero or negative error code.
+   */
+  int pdc_read(uint8_t* buf, size_t size)
+  {
+    m_twi->TWI_RPR = (uint32_t) (uintptr_t) buf;
+    m_twi->TWI_RCR = size;
+    m_twi->TWI_PTCR = TWI_PTCR_RXTEN;
+    int res = pdc_await(TWI_SR_ENDRX, m_twi->TWI_RCR);
+    m_twi->TWI_PTCR = TWI_PTCR_RXTDIS;
+    return (res);
+  }
+
+  /**
+   * Issue stop condition and wait for completion. Return zero(0) if
+   * successful otherwise negative error code.
+   * @param[in] data data bytes written.
+   * @return zero or negative error code.
+   */
+  int stop_condition(bool data)
+  {
     m_twi->TWI_CR = TWI_CR_STOP;
     m_state = BUSY_STATE;
-    do {
-      sr = m_twi->TWI_SR;
-      if (sr & TWI_SR_NACK) return (false);
-      if (--retry == 0) return (false);
-    } while ((sr & TWI_SR_TXCOMP) == 0);
+    uint32_t sr = iowait(TWI_SR_TXCOMP);
+    if (sr == 0) return (E_TIMEOUT);
+    if (sr & (TWI_SR_NACK | TWI_SR_ARBLST)) return (error(sr, data));
+    return (0);
+  }
+
+  /**
+   * Prepare retry after arbitration loss. Wait for the controller to
+   * end the lost transfer; the start condition of the retry is
+   * issued when the bus is free. Return true(1) if successful
+   * otherwise false(0) on timeout.
+   * @return bool.
+   */
+  bool restart()
+  {
+    uint32_t start = micros();
+    m_state = BUSY_STATE;
+    while ((m_twi->TWI_SR & TWI_SR_TXCOMP) == 0)
+      if (is_expired(start)) return (false);
     return (true);
   }
+
+  /**
+   * Return true(1) if a phase with the given result should be
+   * retried otherwise false(0). Arbitration loss is counted and the
+   * first phase of the transaction is retried when the bus is free.
+   * The result is set to E_TIMEOUT if the bus is not released.
+   * @param[in,out] res number of bytes or negative error code.
+   * @param[in] first first phase of transaction.
+   * @param[in] retry number of retries so far.
+   * @return bool.
+   */
+  bool is_retry(int& res, bool first, uint8_t retry)
+  {
+    if (res != E_ARB_LOST || !arbitration_lost(retry) || !first) return (false);
+    if (restart()) return (true);
+    res = E_TIMEOUT;
+    return (false);
+  }
+
+  /**
+   * Return true(1) if the transfer timeout has expired since the
+   * given start time otherwise false(0).
+   * @param[in] start time (us).
+   * @return bool.
+   */
+  bool is_expired(uint32_t start) const
+  {
+    return ((m_timeout != 0) && (micros() - start >= m_timeout * 1000UL));
+  }
+
+  /**
+   * Wait for any of the given status flags, not acknowledged or
+   * arbitration lost. The wait is bounded by the transfer timeout.
+   * Return status register value or zero(0) on timeout.
+   * @param[in] flags status register flags.
+   * @return status register value or zero.
+   */
+  uint32_t iowait(uint32_t flags)
+  {
+    uint32_t start = micros();
+    uint32_t sr;
+    while (((sr = m_twi->TWI_SR) & (flags | TWI_SR_NACK | TWI_SR_ARBLST)) == 0)
+      if (is_expired(start)) return (0);
+    return (sr);
+  }
+
+  /**
+   * Configure pins for the controller and initiate master mode.
+   * Interrupt sources are only enabled for asynchronous
+   * transactions.
+   */
+  void configure()
+  {
+    const PinDescription& sda = g_APinDescription[m_sda];
+    const PinDescription& scl = g_APinDescription[m_scl];
+    PIO_Configure(sda.pPort, sda.ulPinType, sda.ulPin, sda.ulPinConfiguration);
+    PIO_Configure(scl.pPort, scl.ulPinType, scl.ulPin, scl.ulPinConfiguration);
+    TWI_ConfigureMaster(m_twi, m_freq, VARIANT_MCK);
+    m_twi->TWI_IDR = 0xffffffff;
+  }
 };
 };
 
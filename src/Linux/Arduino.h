@@ -0,0 +1,79 @@
+/**
+ * @file Linux/Arduino.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2017, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef LINUX_ARDUINO_H
+#define LINUX_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * Minimal Arduino core functions for host builds of the bus
+ * managers and device drivers. Include before TWI.h.
+ */
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*) (addr))
+
+inline void yield()
+{
+  sched_yield();
+}
+
+/**
+ * Return micro-seconds. Wraps at 32-bit as on the Arduino; elapsed
+ * time is calculated with 32-bit unsigned arithmetic.
+ */
+inline uint32_t micros()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint32_t) ((uint64_t) ts.tv_sec * 1000000UL + ts.tv_nsec / 1000));
+}
+
+/**
+ * Return milli-seconds. Wraps at 32-bit as on the Arduino.
+ */
+inline uint32_t millis()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint32_t) ((uint64_t) ts.tv_sec * 1000UL + ts.tv_nsec / 1000000));
+}
+
+inline void delayMicroseconds(unsigned int us)
+{
+  usleep(us);
+}
+
+inline void delay(unsigned long ms)
+{
+  usleep(ms * 1000UL);
+}
+
+inline void noInterrupts()
+{
+}
+
+inline void interrupts()
+{
+}
+#endif
@@ -0,0 +1,286 @@
+/**
+ * @file Linux/TWI.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2017, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef LINUX_TWI_H
+#define LINUX_TWI_H
+
+#include "TWI.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+/**
+ * Linux Two-Wire Interface (TWI) class using the i2c-dev driver.
+ * Write and read requests within a transaction are collected and
+ * issued as a single combined transfer (ioctl I2C_RDWR) with
+ * repeated start conditions. Writes are deferred until the next
+ * read or the end of the transaction; write errors are returned by
+ * the read, or by release() with the error code in last_error().
+ */
+namespace Linux {
+class TWI : public ::TWI {
+public:
+  /**
+   * Construct Two-Wire Interface (TWI) for given i2c-dev device.
+   * @param[in] path device path (default "/dev/i2c-1").
+   */
+  TWI(const char* path = "/dev/i2c-1") :
+    m_fd(open(path, O_RDWR)),
+    m_close(true),
+    m_msgs(0),
+    m_size(0)
+  {
+  }
+
+  /**
+   * Construct Two-Wire Interface (TWI) for given file descriptor.
+   * The file descriptor is not closed by the bus manager.
+   * @param[in] fd file descriptor.
+   */
+  TWI(int fd) :
+    m_fd(fd),
+    m_close(false),
+    m_msgs(0),
+    m_size(0)
+  {
+  }
+
+  /**
+   * Close device.
+   */
+  ~TWI()
+  {
+    if (m_close && m_fd >= 0) close(m_fd);
+  }
+
+  /**
+   * Return true(1) if the device is open otherwise false(0).
+   * @return bool.
+   */
+  bool is_open() const
+  {
+    return (m_fd >= 0);
+  }
+
+  /**
+   * @override{TWI}
+   * Start transaction for given device driver. Return true(1) if
+   * successful otherwise false(0).
+   * @return bool.
+   */
+  virtual bool acquire()
+  {
+    m_msgs = 0;
+    m_size = 0;
+    return (m_fd >= 0);
+  }
+
+  /**
+   * @override{TWI}
+   * Stop transaction. Issue deferred writes. Return true(1) if
+   * successful otherwise false(0); the error code of the deferred
+   * writes is available with last_error().
+   * @return bool.
+   */
+  virtual bool release()
+  {
+    if (m_msgs == 0) return (true);
+    int res = transfer();
+    if (res >= 0) return (true);
+    m_error = res;
+    return (false);
+  }
+
+  /**
+   * @override{TWI}
+   * Read data from device with given address into given io vector
+   * buffers. Deferred writes are issued in the same transfer. A
+   * single buffer is read directly; several buffers are read through
+   * the free part of the deferred write buffer and copied. Deferred
+   * writes are issued first when the message table or buffer is
+   * full.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes read or negative error code.
+   */
+  virtual int read(uint8_t addr, iovec_t* vp)
+  {
+    // Issue pending messages if the message table is full
+    int res;
+    if (m_msgs == MSG_MAX && (res = transfer()) < 0) return (res);
+
+    // Check for single buffer read
+    size_t count = iovec_size(vp);
+    bool single = (vp[0].buf == NULL) || (vp[1].buf == NULL);
+    if (single) {
+      if (!message(addr, I2C_M_RD, vp[0].buf, count)) return (E_BUS_ERROR);
+      res = transfer();
+      if (res < 0) return (res);
+      return (count);
+    }
+
+    // Read into free part of buffer and scatter to io vector buffers
+    if (m_size + count > BUF_MAX) {
+      if (m_msgs != 0 && (res = transfer()) < 0) return (res);
+      if (count > BUF_MAX) return (E_BUS_ERROR);
+    }
+    uint8_t* bp = m_buf + m_size;
+    if (!message(addr, I2C_M_RD, bp, count)) return (E_BUS_ERROR);
+    res = transfer();
+    if (res < 0) return (res);
+    for (; vp->buf != NULL; vp++) {
+      memcpy(vp->buf, bp, vp->size);
+      bp += vp->size;
+    }
+    return (count);
+  }
+
+  /**
+   * @override{TWI}
+   * Write data to device with from given io vector. The write is
+   * deferred to the next read or release. An address only write
+   * (NULL io vector) is issued directly.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes written or negative error code.
+   */
+  virtual int write(uint8_t addr, iovec_t* vp)
+  {
+    // Issue pending messages if the message table is full
+    int res;
+    if (m_msgs == MSG_MAX && (res = transfer()) < 0) return (res);
+
+    // Check for scan of given device
+    if (vp == NULL) {
+      if (!message(addr, 0, NULL, 0)) return (E_BUS_ERROR);
+      res = transfer();
+      if (res < 0) return (res);
+      return (0);
+    }
+
+    // Issue pending messages if the deferred write buffer is full
+    size_t count = iovec_size(vp);
+    if (m_size + count > BUF_MAX) {
+      if (m_msgs != 0 && (res = transfer()) < 0) return (res);
+      if (count > BUF_MAX) return (E_BUS_ERROR);
+    }
+
+    // Copy io vector buffers to deferred write buffer
+    uint8_t* bp = m_buf + m_size;
+    size_t size = 0;
+    for (; vp->buf != NULL; vp++) {
+      memcpy(bp + size, vp->buf, vp->size);
+      size += vp->size;
+    }
+    if (!message(addr, 0, bp, count)) return (E_BUS_ERROR);
+    m_size += count;
+    return (count);
+  }
+
+protected:
+  /** Maximum number of messages in a transfer. */
+  static const size_t MSG_MAX = 4;
+
+  /** Maximum number of deferred write bytes in a transfer. */
+  static const size_t BUF_MAX = 256;
+
+  /** File descriptor. */
+  int m_fd;
+
+  /** Close file descriptor on destruction. */
+  bool m_close;
+
+  /** Messages in current transfer. */
+  struct i2c_msg m_msg[MSG_MAX];
+
+  /** Number of messages. */
+  size_t m_msgs;
+
+  /** Deferred write buffer. */
+  uint8_t m_buf[BUF_MAX];
+
+  /** Number of bytes in deferred write buffer. */
+  size_t m_size;
+
+  /**
+   * Append message to current transfer. Return true(1) if
+   * successful otherwise false(0).
+   * @param[in] addr device address.
+   * @param[in] flags message flags.
+   * @param[in] buf buffer pointer.
+   * @param[in] count buffer size in bytes.
+   * @return bool.
+   */
+  bool message(uint8_t addr, uint16_t flags, void* buf, size_t count)
+  {
+    if (m_msgs == MSG_MAX) return (false);
+    struct i2c_msg* mp = &m_msg[m_msgs++];
+    mp->addr = addr >> 1;
+    mp->flags = flags;
+    mp->len = count;
+    mp->buf = (uint8_t*) buf;
+    return (true);
+  }
+
+  /**
+   * Issue collected messages as a single combined transfer. The
+   * transfer is retried when the adapter reports arbitration loss
+   * (EAGAIN). Return number of messages transferred or negative
+   * error code; mapped from the adapter fault code.
+   * @return number of messages or negative error code.
+   */
+  int transfer()
+  {
+    struct i2c_rdwr_ioctl_data data;
+    data.msgs = m_msg;
+    data.nmsgs = m_msgs;
+    m_msgs = 0;
+    m_size = 0;
+    for (uint8_t retry = 0;; retry++) {
+      int res = ioctl(m_fd, I2C_RDWR, &data);
+      if (res >= 0) return (res);
+      if (errno != EAGAIN || !arbitration_lost(retry)) return (error(errno));
+    }
+  }
+
+  /**
+   * Map given adapter fault code to error code.
+   * @param[in] err fault code (errno).
+   * @return negative error code.
+   */
+  static int error(int err)
+  {
+    switch (err) {
+    case ENXIO:
+      return (E_ADDR_NACK);
+    case EREMOTEIO:
+      return (E_DATA_NACK);
+    case ETIMEDOUT:
+      return (E_TIMEOUT);
+    case EAGAIN:
+      return (E_ARB_LOST);
+    default:
+      return (E_BUS_ERROR);
+    }
+  }
+};
+};
+#endif
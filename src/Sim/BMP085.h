@@ -0,0 +1,143 @@
+/**
+ * @file Sim/BMP085.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2017, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef SIM_BMP085_H
+#define SIM_BMP085_H
+
+#include "Sim/TWI.h"
+
+/**
+ * Simulated Bosch BMP085 Digital Pressure Sensor. Calibration
+ * coefficients and raw sensor values are the example values from
+ * the data sheet (chap. 3.5, pp. 13); temperature 15.0 C and
+ * pressure 69964 Pa.
+ */
+namespace Sim {
+class BMP085 : public TWI::Slave {
+public:
+  /**
+   * Construct BMP085 device model with I2C address(0x77).
+   */
+  BMP085() :
+    TWI::Slave(0x77),
+    m_ut(27898),
+    m_up(23843),
+    m_pointer(0),
+    m_index(0)
+  {
+    static const int16_t param[] = {
+      408, -72, -14383, 32741, 32757, 23153, 6190, 4, -32768, -8711, 2868
+    };
+    memset(m_reg, 0, sizeof(m_reg));
+    for (size_t i = 0; i < sizeof(param) / sizeof(param[0]); i++) {
+      m_reg[COEFF_REG + i * 2] = param[i] >> 8;
+      m_reg[COEFF_REG + i * 2 + 1] = param[i];
+    }
+  }
+
+  /**
+   * Set raw sensor values for following conversions.
+   * @param[in] ut raw temperature value.
+   * @param[in] up raw pressure value (ultra low power mode).
+   */
+  void raw(uint16_t ut, uint32_t up)
+  {
+    m_ut = ut;
+    m_up = up;
+  }
+
+  /**
+   * @override{Sim::TWI::Slave}
+   * Device addressed; reset write index.
+   */
+  virtual bool address(bool read)
+  {
+    (void) read;
+    m_index = 0;
+    return (true);
+  }
+
+  /**
+   * @override{Sim::TWI::Slave}
+   * First byte is register address, following bytes are written to
+   * the register. Writing the command register starts conversion.
+   */
+  virtual bool write(uint8_t data)
+  {
+    if (m_index++ == 0) {
+      m_pointer = data;
+      return (true);
+    }
+    m_reg[m_pointer] = data;
+    if (m_pointer == CMD_REG) convert(data);
+    m_pointer += 1;
+    return (true);
+  }
+
+  /**
+   * @override{Sim::TWI::Slave}
+   * Read register and increment register pointer.
+   */
+  virtual uint8_t read()
+  {
+    return (m_reg[m_pointer++]);
+  }
+
+protected:
+  /** Register addresses. */
+  enum {
+    COEFF_REG = 0xAA,
+    CMD_REG = 0xF4,
+    RES_REG = 0xF6
+  };
+
+  /** Raw temperature value. */
+  uint16_t m_ut;
+
+  /** Raw pressure value. */
+  uint32_t m_up;
+
+  /** Register file. */
+  uint8_t m_reg[256];
+
+  /** Register pointer. */
+  uint8_t m_pointer;
+
+  /** Write byte index. */
+  uint8_t m_index;
+
+  /**
+   * Perform conversion command; update result registers.
+   * @param[in] cmd conversion command.
+   */
+  void convert(uint8_t cmd)
+  {
+    if (cmd == 0x2E) {
+      m_reg[RES_REG] = m_ut >> 8;
+      m_reg[RES_REG + 1] = m_ut;
+    }
+    else if ((cmd & 0x3f) == 0x34) {
+      uint32_t value = m_up << (8 - (cmd >> 6));
+      m_reg[RES_REG] = value >> 16;
+      m_reg[RES_REG + 1] = value >> 8;
+      m_reg[RES_REG + 2] = value;
+    }
+  }
+};
+};
+#endif
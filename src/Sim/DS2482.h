@@ -0,0 +1,237 @@
+/**
+ * @file Sim/DS2482.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2017, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef SIM_DS2482_H
+#define SIM_DS2482_H
+
+#include "Sim/TWI.h"
+
+/**
+ * Simulated DS2482 Single-Channel 1-Wire Master. One wire operations
+ * complete immediately. Bytes read from the one wire bus are taken
+ * from a loaded buffer (0xff when empty); bytes written are counted.
+ */
+namespace Sim {
+class DS2482 : public TWI::Slave {
+public:
+  /**
+   * Construct DS2482 device model with given sub-address.
+   * @param[in] subaddr sub-address for device (0..3).
+   */
+  DS2482(uint8_t subaddr = 0) :
+    TWI::Slave(0x18 | (subaddr & 0x03)),
+    m_status(RST),
+    m_data(0),
+    m_config(0),
+    m_channel(0xb8),
+    m_pointer(STATUS_REGISTER),
+    m_count(0),
+    m_presence(true),
+    m_buf(NULL),
+    m_size(0),
+    m_written(0)
+  {
+  }
+
+  /**
+   * Load given buffer with bytes to read from the one wire bus.
+   * @param[in] buf buffer pointer.
+   * @param[in] size number of bytes.
+   */
+  void load(const uint8_t* buf, size_t size)
+  {
+    m_buf = buf;
+    m_size = size;
+  }
+
+  /**
+   * Set presence of devices on the one wire bus.
+   * @param[in] presence devices on bus.
+   */
+  void presence(bool presence)
+  {
+    m_presence = presence;
+  }
+
+  /**
+   * Return number of bytes written to the one wire bus.
+   * @return number of bytes.
+   */
+  size_t written() const
+  {
+    return (m_written);
+  }
+
+  /**
+   * @override{Sim::TWI::Slave}
+   * Device addressed; reset command index.
+   */
+  virtual bool address(bool read)
+  {
+    if (!read) m_count = 0;
+    return (true);
+  }
+
+  /**
+   * @override{Sim::TWI::Slave}
+   * Collect command and parameter; perform command.
+   */
+  virtual bool write(uint8_t data)
+  {
+    if (m_count == 2) return (false);
+    if (m_count++ == 0) {
+      m_cmd = data;
+      switch (m_cmd) {
+      case DEVICE_RESET:
+	m_status = RST;
+	m_config = 0;
+	m_pointer = STATUS_REGISTER;
+	break;
+      case ONE_WIRE_RESET:
+	m_status = m_presence ? PPD : 0;
+	m_pointer = STATUS_REGISTER;
+	break;
+      case ONE_WIRE_READ_BYTE:
+	if (m_size != 0) {
+	  m_data = *m_buf++;
+	  m_size -= 1;
+	}
+	else m_data = 0xff;
+	m_status = 0;
+	m_pointer = STATUS_REGISTER;
+	break;
+      }
+      return (true);
+    }
+    switch (m_cmd) {
+    case SET_READ_POINTER:
+      m_pointer = data;
+      break;
+    case WRITE_CONFIGURATION:
+      if ((data >> 4) != (~data & 0xf)) return (false);
+      m_config = data & 0xf;
+      m_status &= ~RST;
+      m_pointer = CONFIGURATION_REGISTER;
+      break;
+    case CHANNEL_SELECT:
+      m_channel = data;
+      m_pointer = CHANNEL_SELECTION_REGISTER;
+      break;
+    case ONE_WIRE_SINGLE_BIT:
+      m_status = (data & 0x80) ? SBR : 0;
+      m_pointer = STATUS_REGISTER;
+      break;
+    case ONE_WIRE_WRITE_BYTE:
+      m_written += 1;
+      m_status = 0;
+      m_pointer = STATUS_REGISTER;
+      break;
+    case ONE_WIRE_TRIPLET:
+      m_status = SBR | TSB;
+      m_pointer = STATUS_REGISTER;
+      break;
+    default:
+      return (false);
+    }
+    return (true);
+  }
+
+  /**
+   * @override{Sim::TWI::Slave}
+   * Read register given by read pointer.
+   */
+  virtual uint8_t read()
+  {
+    switch (m_pointer) {
+    case STATUS_REGISTER:
+      return (m_status);
+    case READ_DATA_REGISTER:
+      return (m_data);
+    case CHANNEL_SELECTION_REGISTER:
+      return (m_channel);
+    case CONFIGURATION_REGISTER:
+      return (m_config);
+    }
+    return (0xff);
+  }
+
+protected:
+  /** Device registers (read pointer codes). */
+  enum {
+    STATUS_REGISTER = 0xf0,
+    READ_DATA_REGISTER = 0xe1,
+    CHANNEL_SELECTION_REGISTER = 0xd2,
+    CONFIGURATION_REGISTER = 0xc3
+  };
+
+  /** Function commands. */
+  enum {
+    DEVICE_RESET = 0xf0,
+    SET_READ_POINTER = 0xe1,
+    WRITE_CONFIGURATION = 0xd2,
+    CHANNEL_SELECT = 0xc3,
+    ONE_WIRE_RESET = 0xb4,
+    ONE_WIRE_SINGLE_BIT = 0x87,
+    ONE_WIRE_WRITE_BYTE = 0xa5,
+    ONE_WIRE_READ_BYTE = 0x96,
+    ONE_WIRE_TRIPLET = 0x78
+  };
+
+  /** Status register bits. */
+  enum {
+    PPD = 0x02,
+    RST = 0x10,
+    SBR = 0x20,
+    TSB = 0x40
+  };
+
+  /** Status register. */
+  uint8_t m_status;
+
+  /** Read data register. */
+  uint8_t m_data;
+
+  /** Configuration register. */
+  uint8_t m_config;
+
+  /** Channel selection register. */
+  uint8_t m_channel;
+
+  /** Read pointer. */
+  uint8_t m_pointer;
+
+  /** Current command. */
+  uint8_t m_cmd;
+
+  /** Number of command bytes. */
+  uint8_t m_count;
+
+  /** Devices on one wire bus. */
+  bool m_presence;
+
+  /** One wire read buffer. */
+  const uint8_t* m_buf;
+
+  /** Remaining bytes in one wire read buffer. */
+  size_t m_size;
+
+  /** Number of bytes written to one wire bus. */
+  size_t m_written;
+};
+};
+#endif
@@ -0,0 +1,88 @@
+/**
+ * @file Sim/PCF8574.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2017, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef SIM_PCF8574_H
+#define SIM_PCF8574_H
+
+#include "Sim/TWI.h"
+
+/**
+ * Simulated PCF8574/PCF8574A Remote 8-bit I/O expander. Pins written
+ * high are quasi-bidirectional and read the external pin levels.
+ */
+namespace Sim {
+class PCF8574 : public TWI::Slave {
+public:
+  /**
+   * Construct PCF8574 device model with given sub-address.
+   * @param[in] subaddr sub-address (0..7, default 7).
+   * @param[in] addr base address (default 0x20, PCF8574A 0x38).
+   */
+  PCF8574(uint8_t subaddr = 7, uint8_t addr = 0x20) :
+    TWI::Slave(addr | (subaddr & 0x7)),
+    m_port(0xff),
+    m_pins(0xff)
+  {
+  }
+
+  /**
+   * Return port value written by the bus manager.
+   * @return port value.
+   */
+  uint8_t port() const
+  {
+    return (m_port);
+  }
+
+  /**
+   * Set external pin levels.
+   * @param[in] pins pin levels.
+   */
+  void pins(uint8_t pins)
+  {
+    m_pins = pins;
+  }
+
+  /**
+   * @override{Sim::TWI::Slave}
+   * Write port value.
+   */
+  virtual bool write(uint8_t data)
+  {
+    m_port = data;
+    return (true);
+  }
+
+  /**
+   * @override{Sim::TWI::Slave}
+   * Read pin values.
+   */
+  virtual uint8_t read()
+  {
+    return (m_port & m_pins);
+  }
+
+protected:
+  /** Port register. */
+  uint8_t m_port;
+
+  /** External pin levels. */
+  uint8_t m_pins;
+};
+};
+#endif
@@ -0,0 +1,239 @@
+/**
+ * @file Sim/Si70XX.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2017, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef SIM_SI70XX_H
+#define SIM_SI70XX_H
+
+#include "Sim/TWI.h"
+
+/**
+ * Simulated Silicon Labs Si70XX Humidity and Temperature Sensor.
+ * Measurements complete immediately. The device does not acknowledge
+ * read requests until a measurement command has been issued (no
+ * hold master mode).
+ */
+namespace Sim {
+class Si70XX : public TWI::Slave {
+public:
+  /**
+   * Construct Si70XX device model with I2C address(0x40).
+   */
+  Si70XX() :
+    TWI::Slave(0x40),
+    m_rh(0x7C80),
+    m_temp(0x6680),
+    m_conversion(0),
+    m_user(0x3A),
+    m_count(0),
+    m_size(0),
+    m_index(0),
+    m_busy(false),
+    m_polls(0)
+  {
+  }
+
+  /**
+   * Set raw sensor values for following measurements. Default
+   * values are 54.8 %RH and 23.6 C.
+   * @param[in] rh raw humidity value.
+   * @param[in] temp raw temperature value.
+   */
+  void raw(uint16_t rh, uint16_t temp)
+  {
+    m_rh = rh;
+    m_temp = temp;
+  }
+
+  /**
+   * Set number of read requests that are not acknowledged after a
+   * measurement command (conversion time).
+   * @param[in] polls number of read requests.
+   */
+  void conversion(uint8_t polls)
+  {
+    m_conversion = polls;
+  }
+
+  /**
+   * @override{Sim::TWI::Slave}
+   * Device addressed; reset command or response index. Read
+   * requests are not acknowledged while measuring.
+   */
+  virtual bool address(bool read)
+  {
+    if (read && m_busy) {
+      if (m_polls != 0) {
+	m_polls -= 1;
+	return (false);
+      }
+      m_busy = false;
+    }
+    if (!read) m_count = 0;
+    m_index = 0;
+    return (true);
+  }
+
+  /**
+   * @override{Sim::TWI::Slave}
+   * Collect command bytes and prepare response.
+   */
+  virtual bool write(uint8_t data)
+  {
+    if (m_count == sizeof(m_cmd)) return (false);
+    m_cmd[m_count++] = data;
+    switch (m_cmd[0]) {
+    case 0xE5:
+    case 0xF5:
+      measure(m_rh);
+      break;
+    case 0xE3:
+    case 0xF3:
+      measure(m_temp);
+      break;
+    case 0xE0:
+      response(m_temp, true);
+      break;
+    case 0xE6:
+      if (m_count == 2) m_user = data;
+      break;
+    case 0xE7:
+      m_response[0] = m_user;
+      m_size = 1;
+      break;
+    case 0xFA:
+      if (m_count == 2) serial_number(SNA, 1);
+      break;
+    case 0xFC:
+      if (m_count == 2) serial_number(SNB, 2);
+      break;
+    case 0x84:
+      if (m_count == 2 && data == 0xB8) {
+	m_response[0] = REV;
+	m_size = 1;
+      }
+      break;
+    }
+    return (true);
+  }
+
+  /**
+   * @override{Sim::TWI::Slave}
+   * Return next response byte.
+   */
+  virtual uint8_t read()
+  {
+    if (m_index < m_size) return (m_response[m_index++]);
+    return (0xff);
+  }
+
+protected:
+  /** Electronic serial number; SNA_3..SNA_0 and SNB_3..SNB_0. */
+  static const uint32_t SNA = 0x12345678;
+  static const uint32_t SNB = 0x15ffb5ff;
+
+  /** Firmware revision; 0xFF version 1.0, 0x20 version 2.0. */
+  static const uint8_t REV = 0x20;
+
+  /** Raw humidity value. */
+  uint16_t m_rh;
+
+  /** Raw temperature value. */
+  uint16_t m_temp;
+
+  /** Conversion time in read requests. */
+  uint8_t m_conversion;
+
+  /** User register 1. */
+  uint8_t m_user;
+
+  /** Command buffer. */
+  uint8_t m_cmd[2];
+
+  /** Number of command bytes. */
+  uint8_t m_count;
+
+  /** Response buffer. */
+  uint8_t m_response[12];
+
+  /** Response size. */
+  uint8_t m_size;
+
+  /** Response index. */
+  uint8_t m_index;
+
+  /** Measurement in progress. */
+  bool m_busy;
+
+  /** Remaining busy polls. */
+  uint8_t m_polls;
+
+  /**
+   * Start measurement with given result.
+   * @param[in] value raw sensor value.
+   */
+  void measure(uint16_t value)
+  {
+    response(value, true);
+    m_busy = true;
+    m_polls = m_conversion;
+  }
+
+  /**
+   * Set 16-bit response with optional checksum.
+   * @param[in] value response.
+   * @param[in] check append crc.
+   */
+  void response(uint16_t value, bool check)
+  {
+    m_response[0] = value >> 8;
+    m_response[1] = value;
+    m_response[2] = crc_update(crc_update(0, m_response[0]), m_response[1]);
+    m_size = check ? 3 : 2;
+  }
+
+  /**
+   * Set serial number response (most significant byte first) with
+   * checksum after every given number of bytes.
+   * @param[in] sn serial number.
+   * @param[in] n number of bytes per checksum.
+   */
+  void serial_number(uint32_t sn, uint8_t n)
+  {
+    uint8_t crc = 0;
+    m_size = 0;
+    for (uint8_t i = 1; i <= 4; i++) {
+      uint8_t data = sn >> (32 - i * 8);
+      crc = crc_update(crc, data);
+      m_response[m_size++] = data;
+      if ((i % n) == 0) m_response[m_size++] = crc;
+    }
+  }
+
+  static uint8_t crc_update(uint8_t crc, uint8_t data)
+  {
+    crc ^= data;
+    for (uint8_t i = 8; i != 0; i--) {
+      uint8_t msb = (crc & 0x80);
+      crc <<= 1;
+      if (msb) crc ^= 0x31;
+    }
+    return (crc);
+  }
+};
+};
+#endif
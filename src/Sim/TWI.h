@@ -0,0 +1,306 @@
+/**
+ * @file Sim/TWI.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2017, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef SIM_TWI_H
+#define SIM_TWI_H
+
+#include "TWI.h"
+
+/**
+ * Simulated Two-Wire Interface (TWI) class. Transactions are routed
+ * to registered slave device models. The bus time is accumulated
+ * from the clock frequency; start, repeated start and stop
+ * conditions count as one clock period, address and data bytes as
+ * nine (eight data bits and acknowledge). A second master may be
+ * simulated with arbitration losses; see arbitrate().
+ */
+namespace Sim {
+class TWI : public ::TWI {
+public:
+  /**
+   * Abstract slave device model class. Receives bus events byte by
+   * byte.
+   */
+  class Slave {
+  public:
+    /**
+     * Construct slave device model with given device address.
+     * @param[in] addr device address.
+     */
+    Slave(uint8_t addr) :
+      m_next(NULL),
+      m_addr(addr << 1)
+    {
+    }
+
+    /**
+     * @override{Sim::TWI::Slave}
+     * Device addressed after start or repeated start condition.
+     * Return true(1) to acknowledge otherwise false(0), e.g. when
+     * busy.
+     * @param[in] read request.
+     * @return bool.
+     */
+    virtual bool address(bool read)
+    {
+      (void) read;
+      return (true);
+    }
+
+    /**
+     * @override{Sim::TWI::Slave}
+     * Receive data byte from bus manager. Return true(1) to
+     * acknowledge otherwise false(0).
+     * @param[in] data byte.
+     * @return bool.
+     */
+    virtual bool write(uint8_t data) = 0;
+
+    /**
+     * @override{Sim::TWI::Slave}
+     * Return data byte to bus manager.
+     * @return data byte.
+     */
+    virtual uint8_t read() = 0;
+
+    /**
+     * @override{Sim::TWI::Slave}
+     * Stop condition after device was addressed.
+     */
+    virtual void stop()
+    {
+    }
+
+  protected:
+    friend class TWI;
+
+    /** Next slave device model on bus. */
+    Slave* m_next;
+
+    /** Device address. */
+    uint8_t m_addr;
+  };
+
+  /**
+   * Construct simulated Two-Wire Interface (TWI) with given clock
+   * frequency.
+   * @param[in] freq bus manager clock frequency (HZ).
+   */
+  TWI(uint32_t freq = DEFAULT_FREQ) :
+    m_freq(freq),
+    m_slaves(NULL),
+    m_slave(NULL),
+    m_start(false),
+    m_arbitration(0),
+    m_bits(0)
+  {
+  }
+
+  /**
+   * Attach given slave device model to the bus.
+   * @param[in] slave device model.
+   */
+  void attach(Slave& slave)
+  {
+    slave.m_next = m_slaves;
+    m_slaves = &slave;
+  }
+
+  /**
+   * Simulate a second master on the bus; arbitration is lost on the
+   * given number of following address phases. The other master
+   * completes its transaction before the retry.
+   * @param[in] count number of arbitration losses.
+   */
+  void arbitrate(uint8_t count)
+  {
+    m_arbitration = count;
+  }
+
+  /**
+   * Return accumulated bus time in clock periods.
+   * @return clock periods.
+   */
+  uint32_t bits() const
+  {
+    return (m_bits);
+  }
+
+  /**
+   * Return accumulated bus time in micro-seconds.
+   * @return micro-seconds.
+   */
+  uint32_t time() const
+  {
+    return ((uint32_t) (((uint64_t) m_bits * 1000000UL) / m_freq));
+  }
+
+  /**
+   * Reset accumulated bus time.
+   */
+  void reset()
+  {
+    m_bits = 0;
+  }
+
+  /**
+   * @override{TWI}
+   * Start transaction. Return true(1) if successful otherwise
+   * false(0).
+   * @return bool.
+   */
+  virtual bool acquire()
+  {
+    m_start = true;
+    m_bits += CONDITION_BITS;
+    return (true);
+  }
+
+  /**
+   * @override{TWI}
+   * Stop transaction. Return true(1) if successful otherwise
+   * false(0).
+   * @return bool.
+   */
+  virtual bool release()
+  {
+    if (m_slave != NULL) m_slave->stop();
+    m_slave = NULL;
+    m_start = false;
+    m_bits += CONDITION_BITS;
+    return (true);
+  }
+
+  /**
+   * @override{TWI}
+   * Read data from device with given address into given io vector
+   * buffers.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes read or negative error code.
+   */
+  virtual int read(uint8_t addr, iovec_t* vp)
+  {
+    // Address device with read request and check that it acknowledges
+    int res = start(addr, true);
+    if (res < 0) return (res);
+
+    // Read bytes from device model into io vector buffers
+    int count = 0;
+    for(; vp->buf != NULL; vp++) {
+      uint8_t* bp = (uint8_t*) vp->buf;
+      size_t size = vp->size;
+      count += size;
+      while (size--) {
+	m_bits += BYTE_BITS;
+	*bp++ = m_slave->read();
+      }
+    }
+    return (count);
+  }
+
+  /**
+   * @override{TWI}
+   * Write data to device with from given io vector.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes written or negative error code.
+   */
+  virtual int write(uint8_t addr, iovec_t* vp)
+  {
+    // Address device with write request and check that it acknowledges
+    int res = start(addr, false);
+    if (res < 0) return (res);
+    if (vp == NULL) return (0);
+
+    // Write given io vector buffers to device model
+    int count = 0;
+    m_acked = 0;
+    for(; vp->buf != NULL; vp++) {
+      const uint8_t* bp = (const uint8_t*) vp->buf;
+      size_t size = vp->size;
+      count += size;
+      while (size--) {
+	m_bits += BYTE_BITS;
+	if (!m_slave->write(*bp++)) return (E_DATA_NACK);
+	m_acked += 1;
+      }
+    }
+    return (count);
+  }
+
+protected:
+  /** Start, repeated start and stop condition time in clock periods. */
+  static const uint8_t CONDITION_BITS = 1;
+
+  /** Address and data byte time in clock periods (with acknowledge). */
+  static const uint8_t BYTE_BITS = 9;
+
+  /** Transaction time of the other master on arbitration loss. */
+  static const uint8_t ARBITRATION_BITS = 4 * BYTE_BITS + 2 * CONDITION_BITS;
+
+  /** Clock frequency (Hz). */
+  uint32_t m_freq;
+
+  /** Slave device models. */
+  Slave* m_slaves;
+
+  /** Currently addressed slave device model. */
+  Slave* m_slave;
+
+  /** Transaction state; start or repeated start condition. */
+  bool m_start;
+
+  /** Number of simulated arbitration losses. */
+  uint8_t m_arbitration;
+
+  /** Accumulated bus time in clock periods. */
+  uint32_t m_bits;
+
+  /**
+   * Generate repeated start condition if needed and address device
+   * model. Simulated arbitration losses are retried with a start
+   * condition after the other master transaction. Return zero(0) if
+   * the device acknowledged otherwise negative error code.
+   * @param[in] addr device address.
+   * @param[in] read request.
+   * @return zero or negative error code.
+   */
+  int start(uint8_t addr, bool read)
+  {
+    if (!m_start) m_bits += CONDITION_BITS;
+    m_start = false;
+    for (uint8_t retry = 0; m_arbitration != 0; retry++) {
+      m_arbitration -= 1;
+      m_bits += ARBITRATION_BITS;
+      if (!arbitration_lost(retry)) return (E_ARB_LOST);
+      m_bits += CONDITION_BITS;
+    }
+    m_bits += BYTE_BITS;
+    m_slave = NULL;
+    for (Slave* sp = m_slaves; sp != NULL; sp = sp->m_next) {
+      if (sp->m_addr != addr) continue;
+      if (!sp->address(read)) return (E_ADDR_NACK);
+      m_slave = sp;
+      return (0);
+    }
+    return (E_ADDR_NACK);
+  }
+};
+};
+#endif
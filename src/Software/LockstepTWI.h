@@ -0,0 +1,418 @@
+/**
+ * @file Software/LockstepTWI.h
+ * @version 1.0
+ *
+ * @section License
+ * Copyright (C) 2017, Mikael Patel
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ */
+
+#ifndef SOFTWARE_LOCKSTEP_TWI_H
+#define SOFTWARE_LOCKSTEP_TWI_H
+
+#include "TWI.h"
+#include "GPIO.h"
+
+#if !defined(AVR)
+#error "Software/LockstepTWI.h: AVR only (ARDUINO_ARCH_AVR)"
+#endif
+
+/**
+ * Software Lockstep Two-Wire Interface (TWI) template class for
+ * AVR. A shared clock signal and a number of data signals (lanes)
+ * on consecutive bits of the same port. Each lane is a separate bus
+ * with an identical device (same address). Address, command and
+ * data bytes are written to all lanes with the same port access,
+ * and read bytes are sampled from all lanes with a single port read.
+ * The devices are accessed in the time of one.
+ *
+ * The member functions return a lane mask; bit n is set if lane n
+ * acknowledged. Read data is stored per lane; lane n at buf[n *
+ * count]. Clock stretching is bounded by the transfer timeout; after
+ * a timeout no lane acknowledges and release() fails.
+ *
+ * @param[in] SDA_PIN board pin for first lane data signal.
+ * @param[in] SCL_PIN board pin for clock output signal.
+ * @param[in] LANES number of lanes; data signals on SDA_PIN and
+ * the following bits of the same port (1..8).
+ * @param[in] FREQ clock frequency, zero(0) for no delays
+ * (default 100 kHz).
+ */
+namespace Software {
+template<BOARD::pin_t SDA_PIN, BOARD::pin_t SCL_PIN, uint8_t LANES,
+	 uint32_t FREQ = ::TWI::DEFAULT_FREQ>
+class LockstepTWI {
+public:
+  /** Lane mask for all lanes. */
+  static const uint8_t ALL = (uint8_t) ((1 << LANES) - 1);
+
+  /**
+   * Construct Lockstep Two-Wire Interface (TWI) instance with given
+   * template parameters. Initiate clock and data pins for open
+   * drain mode.
+   */
+  LockstepTWI() :
+    m_timeout(::TWI::DEFAULT_TIMEOUT),
+    m_start(false),
+    m_expired(false)
+  {
+    m_scl.open_drain();
+    uint8_t sreg = SREG;
+    cli();
+    *DDR() &= ~MASK;
+    *PORT() &= ~MASK;
+    SREG = sreg;
+  }
+
+  /**
+   * Start transaction on all lanes. Return lane mask for lanes with
+   * released data signal (bus idle).
+   * @return lane mask.
+   */
+  uint8_t acquire()
+  {
+    m_start = true;
+    m_expired = false;
+    return (start_condition());
+  }
+
+  /**
+   * Stop transaction on all lanes. Return true(1) if successful
+   * otherwise false(0).
+   * @return bool.
+   */
+  bool release()
+  {
+    bool res = stop_condition();
+    m_start = false;
+    return (res);
+  }
+
+  /**
+   * Get transfer timeout; clock stretching limit.
+   * @return milli-seconds (zero for no timeout).
+   */
+  uint16_t timeout() const
+  {
+    return (m_timeout);
+  }
+
+  /**
+   * Set transfer timeout.
+   * @param[in] ms milli-seconds, zero(0) for no timeout (default
+   * TWI::DEFAULT_TIMEOUT).
+   */
+  void timeout(uint16_t ms)
+  {
+    m_timeout = ms;
+  }
+
+  /**
+   * Read data from devices with given address into given buffer.
+   * Lane n is stored at buf[n * count]; the buffer size should be
+   * LANES * count bytes. Return lane mask for devices that
+   * acknowledged the address.
+   * @param[in] addr device address.
+   * @param[in] buf buffer pointer.
+   * @param[in] count number of bytes per lane.
+   * @return lane mask.
+   */
+  uint8_t read(uint8_t addr, void* buf, size_t count)
+  {
+    // Check if repeated start condition should be generated
+    if (!m_start && !repeated_start_condition()) return (0);
+    m_start = false;
+
+    // Address devices with read request
+    uint8_t ack = write_byte(addr | 1);
+
+    // Read bytes from all lanes and acknowledge until required size
+    uint8_t* bp = (uint8_t*) buf;
+    for (size_t i = 0; i < count; i++) {
+      uint8_t sample[8];
+      for (uint8_t bit = 0; bit < 8; bit++)
+	sample[bit] = read_bits();
+      write_bits(i + 1 == count ? MASK : 0);
+      for (uint8_t lane = 0; lane < LANES; lane++) {
+	uint8_t lmask = (1 << (SHIFT + lane));
+	uint8_t data = 0;
+	for (uint8_t bit = 0; bit < 8; bit++)
+	  data = (data << 1) | ((sample[bit] & lmask) != 0);
+	bp[lane * count + i] = data;
+      }
+    }
+    return (m_expired ? 0 : ack);
+  }
+
+  /**
+   * Write data to devices with given address from given io vector.
+   * The same data is written on all lanes. Return lane mask for
+   * devices that acknowledged the address and all data bytes.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @return lane mask.
+   */
+  uint8_t write(uint8_t addr, iovec_t* vp)
+  {
+    // Check if repeated start condition should be generated
+    if (!m_start && !repeated_start_condition()) return (0);
+    m_start = false;
+
+    // Address devices with write request
+    uint8_t ack = write_byte(addr | 0);
+    if (vp == NULL) return (ack);
+
+    // Write given io vector buffers to devices
+    for(; vp->buf != NULL; vp++) {
+      const uint8_t* bp = (const uint8_t*) vp->buf;
+      size_t size = vp->size;
+      while (size--) ack &= write_byte(*bp++);
+    }
+    return (ack);
+  }
+
+  /**
+   * Write data to devices with given address from given buffer.
+   * Return lane mask for devices that acknowledged the address and
+   * all data bytes.
+   * @param[in] addr device address.
+   * @param[in] buf buffer pointer.
+   * @param[in] count buffer size in bytes.
+   * @return lane mask.
+   */
+  uint8_t write(uint8_t addr, const void* buf, size_t count)
+  {
+    iovec_t vec[2];
+    iovec_t* vp = vec;
+    iovec_arg(vp, buf, count);
+    iovec_end(vp);
+    return (write(addr, vec));
+  }
+
+  /**
+   * Write data to devices with given address from given io vector
+   * and read response into given buffer with repeated start
+   * condition. Lane n is stored at buf[n * count]. Return lane mask
+   * for devices that acknowledged the write and the read.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @param[in] buf buffer pointer.
+   * @param[in] count number of bytes per lane.
+   * @return lane mask.
+   */
+  uint8_t write_read(uint8_t addr, iovec_t* vp, void* buf, size_t count)
+  {
+    uint8_t ack = write(addr, vp);
+    if (ack == 0) return (0);
+    return (ack & read(addr, buf, count));
+  }
+
+protected:
+  /** Start condition and clock high delay time (us); see Timing. */
+  static const int T1 = Timing<FREQ>::T1;
+
+  /** Basic clock delay time (us); see Timing. */
+  static const int T2 = Timing<FREQ>::T2;
+
+  /** Data signal port bit position of the first lane. */
+  static const uint8_t SHIFT = (SDA_PIN & 0xf);
+
+  /** Data signal port mask for all lanes. */
+  static const uint8_t MASK = (uint8_t) (ALL << SHIFT);
+
+  static_assert(LANES >= 1 && SHIFT + LANES <= 8,
+		"LockstepTWI: lanes must fit in the data signal port");
+
+  /** Clock signal pin. */
+  GPIO<SCL_PIN> m_scl;
+
+  /** Transfer timeout (ms); clock stretching limit. */
+  uint16_t m_timeout;
+
+  /** Transaction state; start or repeated start condition. */
+  bool m_start;
+
+  /** Clock stretching timeout in current transaction. */
+  bool m_expired;
+
+  /**
+   * Return data signal port input register. Board pins encode the
+   * port input register address and bit; PINx, DDRx and PORTx are
+   * consecutive.
+   * @return register pointer.
+   */
+  static volatile uint8_t* PIN()
+  {
+    return ((volatile uint8_t*) (SDA_PIN >> 4));
+  }
+
+  /**
+   * Return data signal port data direction register.
+   * @return register pointer.
+   */
+  static volatile uint8_t* DDR()
+  {
+    return (PIN() + 1);
+  }
+
+  /**
+   * Return data signal port data register.
+   * @return register pointer.
+   */
+  static volatile uint8_t* PORT()
+  {
+    return (PIN() + 2);
+  }
+
+  /**
+   * Release data signals given by mask and drive the other lanes
+   * low (open drain).
+   * @param[in] mask data signals to release.
+   */
+  static void sda(uint8_t mask)
+  {
+    uint8_t sreg = SREG;
+    cli();
+    *DDR() = (*DDR() & ~MASK) | (MASK & ~mask);
+    SREG = sreg;
+  }
+
+  /**
+   * Delay start condition and clock high time.
+   */
+  static void delay_t1()
+  {
+    if (T1 != 0) delayMicroseconds(T1);
+  }
+
+  /**
+   * Delay basic clock time.
+   */
+  static void delay_t2()
+  {
+    if (T2 != 0) delayMicroseconds(T2);
+  }
+
+  /**
+   * Allow devices to stretch clock signal; bounded by the transfer
+   * timeout. Further bits of the transaction are not delayed after
+   * a timeout. Return true(1) if successful otherwise false(0).
+   * @return bool.
+   */
+  bool clock_stretching()
+  {
+    if (m_expired) return (false);
+    if (m_scl) return (true);
+    uint32_t start = millis();
+    while (!m_scl) {
+      if (m_timeout != 0 && millis() - start >= m_timeout) {
+	m_expired = true;
+	return (false);
+      }
+    }
+    return (true);
+  }
+
+  /**
+   * Generate start condition on all lanes. Return lane mask for
+   * lanes with released data signal.
+   * @return lane mask.
+   */
+  uint8_t start_condition()
+  {
+    sda(MASK);
+    uint8_t idle = (*PIN() & MASK) >> SHIFT;
+    sda(0);
+    delay_t1();
+    m_scl.output();
+    return (idle);
+  }
+
+  /**
+   * Generate repeated start condition on all lanes. Return true(1)
+   * if successful otherwise false(0).
+   * @return bool.
+   */
+  bool repeated_start_condition()
+  {
+    delay_t1();
+    sda(MASK);
+    m_scl.input();
+    delay_t2();
+    if (!clock_stretching()) return (false);
+    sda(0);
+    delay_t1();
+    m_scl.output();
+    return (true);
+  }
+
+  /**
+   * Generate stop condition on all lanes. Return true(1) if
+   * successful otherwise false(0).
+   * @return bool.
+   */
+  bool stop_condition()
+  {
+    delay_t1();
+    sda(0);
+    m_scl.input();
+    delay_t1();
+    if (!clock_stretching()) return (false);
+    sda(MASK);
+    return (true);
+  }
+
+  /**
+   * Write bit on all lanes; data signals given by mask are released.
+   * Return data signal port sample with clock high; all data signals
+   * high (not acknowledged) on clock stretching timeout.
+   * @param[in] mask data signals to release.
+   * @return port sample.
+   */
+  uint8_t write_bits(uint8_t mask)
+  {
+    sda(mask);
+    delay_t2();
+    m_scl.input();
+    delay_t1();
+    if (!clock_stretching()) return (MASK);
+    uint8_t sample = *PIN();
+    m_scl.output();
+    return (sample);
+  }
+
+  /**
+   * Read bit on all lanes. Return data signal port sample.
+   * @return port sample.
+   */
+  uint8_t read_bits()
+  {
+    return (write_bits(MASK));
+  }
+
+  /**
+   * Write byte to all lanes. Return lane mask for devices that
+   * acknowledged.
+   * @param[in] byte to write.
+   * @return lane mask.
+   */
+  uint8_t write_byte(uint8_t byte)
+  {
+    for (uint8_t i = 0; i < 8; i++) {
+      write_bits((byte & 0x80) ? MASK : 0);
+      byte <<= 1;
+    }
+    return ((~read_bits() & MASK) >> SHIFT);
+  }
+};
+};
+#endif
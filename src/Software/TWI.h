@@ -1,6 +1,6 @@
 /**
  * @file Software/TWI.h
- * @version 1.1
+ * @version 1.2
  *
  * @section License
  * Copyright (C) 2017, Mikael Patel
@@ -22,13 +22,44 @@
 #include "TWI.h"
 #include "GPIO.h"
 
+namespace Software {
+/**
+ * Software Two-Wire Interface (TWI) bit timing delays computed from
+ * the clock frequency at compile time. Shared by the software bus
+ * managers.
+ * @param[in] FREQ clock frequency, zero(0) for no delays.
+ */
+template<uint32_t FREQ>
+struct Timing {
+  /** Start condition and clock high delay time: 4.0 us (100 kHz) */
+  static const int T1 = (FREQ == 0) ? 0 : (int) (400000UL / FREQ);
+
+  /** Basic clock delay time: 4.7 us (100 kHz); rounded up */
+  static const int T2 =
+    (FREQ == 0) ? 0 : (int) ((500000UL + FREQ - 1) / FREQ);
+};
+};
+
 /**
- * Software Two-Wire Interface (TWI) template class using GPIO.
+ * Software Two-Wire Interface (TWI) template class using GPIO. The
+ * bit timing delays are computed from the clock frequency at compile
+ * time. The delays are whole micro-seconds and the clock low time is
+ * rounded up; fast mode (400 kHz) is limited to a period of 3 us
+ * (333 kHz). The actual clock frequency is lower as the GPIO access
+ * time is added; see calibrate(). Transactions may also be performed
+ * in the background with the bit rate given by a timer interrupt;
+ * see start() and tick().
  * @param[in] SDA_PIN board pin for data output signal.
  * @param[in] SCL_PIN board pin for clock output signal.
+ * @param[in] FREQ clock frequency, zero(0) for no delays
+ * (default 100 kHz).
+ * @param[in] CLOCK_STRETCHING allow devices to stretch the clock
+ * (default true).
  */
 namespace Software {
-template<BOARD::pin_t SDA_PIN, BOARD::pin_t SCL_PIN>
+template<BOARD::pin_t SDA_PIN, BOARD::pin_t SCL_PIN,
+	 uint32_t FREQ = ::TWI::DEFAULT_FREQ,
+	 bool CLOCK_STRETCHING = true>
 class TWI : public ::TWI {
 public:
   /**
@@ -36,12 +67,50 @@ public:
    * parameters. Initiate GPIO pins for data and clock for open drain
    * mode.
    */
-  TWI()
+  TWI() :
+    m_freq(FREQ),
+    m_start(false),
+    m_lost(false),
+    m_tp(NULL),
+    m_state(IDLE_STATE)
   {
     m_sda.open_drain();
     m_scl.open_drain();
   }
 
+  /**
+   * Measure the clock frequency by issuing clock pulses with the
+   * data signal released (ignored by devices as there is no start
+   * condition). Should be called when the bus is idle. Return
+   * measured clock frequency (Hz) or zero(0) if the clock is held
+   * low by a device.
+   * @return clock frequency (Hz).
+   */
+  uint32_t calibrate()
+  {
+    const uint16_t PULSES = 1000;
+    m_sda.input();
+    m_scl.output();
+    uint32_t start = micros();
+    for (uint16_t i = 0; i < PULSES; i++)
+      if (!write_bit(true)) return (0);
+    uint32_t us = micros() - start;
+    m_scl.input();
+    if (us == 0) us = 1;
+    m_freq = (PULSES * 1000000UL) / us;
+    return (m_freq);
+  }
+
+  /**
+   * Return clock frequency; measured with calibrate() otherwise
+   * the template parameter.
+   * @return clock frequency (Hz).
+   */
+  uint32_t frequency() const
+  {
+    return (m_freq);
+  }
+
   /**
    * @override{TWI}
    * Start transaction for given device driver. Return true(1) if
@@ -50,118 +119,649 @@ public:
    */
   virtual bool acquire()
   {
-    lock();
+    // Issue start condition; wait for the bus to be free or recover
     m_start = true;
-    return (start_condition());
+    m_lost = false;
+    if (start_condition() || restart(0)) return (true);
+    recover();
+    return (false);
   }
 
   /**
    * @override{TWI}
-   * Stop transaction. Mark the bus as available. Return true(1) if
-   * successful otherwise false(0).
+   * Stop transaction. The stop condition is not issued when
+   * arbitration was lost; the bus is used by the other master.
+   * Return true(1) if successful otherwise false(0).
    * @return bool.
    */
   virtual bool release()
   {
-    bool res = stop_condition();
+    bool res = m_lost || stop_condition();
     m_start = false;
-    unlock();
+    m_lost = false;
     return (res);
   }
 
   /**
    * @override{TWI}
-   * Read data from device with given address into given buffer.
+   * Read data from device with given address into given io vector
+   * buffers. The read is retried with a start condition when
+   * arbitration is lost in the first phase of the transaction. In a
+   * later phase E_ARB_LOST is returned as the previous phases must
+   * also be repeated; see Retry.
    * @param[in] addr device address.
-   * @param[in] buf buffer pointer.
-   * @param[in] count buffer size in bytes.
+   * @param[in] vp io vector pointer.
    * @return number of bytes read or negative error code.
    */
-  virtual int read(uint8_t addr, void* buf, size_t count)
+  virtual int read(uint8_t addr, iovec_t* vp)
+  {
+    bool first = m_start;
+    int res;
+    m_expired = false;
+    for (uint8_t retry = 0;; retry++) {
+      m_lost = false;
+      res = receive(addr, vp);
+      if (res != E_ARB_LOST || !arbitration_lost(retry) || !first) break;
+      if (!restart(retry)) {
+	res = E_TIMEOUT;
+	break;
+      }
+    }
+    if (res == E_TIMEOUT || res == E_STRETCH_TIMEOUT) recover();
+    return (res);
+  }
+
+  /**
+   * @override{TWI}
+   * Write data to device with from given io vector. The write is
+   * retried with a start condition when arbitration is lost in the
+   * first phase of the transaction. In a later phase E_ARB_LOST is
+   * returned as the previous phases must also be repeated; see
+   * Retry.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes written or negative error code.
+   */
+  virtual int write(uint8_t addr, iovec_t* vp)
+  {
+    bool first = m_start;
+    int res;
+    m_expired = false;
+    for (uint8_t retry = 0;; retry++) {
+      m_lost = false;
+      res = transmit(addr, vp);
+      if (res != E_ARB_LOST || !arbitration_lost(retry) || !first) break;
+      if (!restart(retry)) {
+	res = E_TIMEOUT;
+	break;
+      }
+    }
+    if (res == E_TIMEOUT || res == E_STRETCH_TIMEOUT) recover();
+    return (res);
+  }
+
+  /**
+   * @override{TWI}
+   * Recover bus after transfer timeout. Issue nine clock pulses with
+   * the data signal released and a stop condition. Return true(1)
+   * if the bus is free otherwise false(0).
+   * @return bool.
+   */
+  virtual bool recover()
+  {
+    m_sda.input();
+    for (uint8_t i = 0; i < 9; i++) {
+      m_scl.output();
+      delay_t2();
+      m_scl.input();
+      delay_t1();
+    }
+    m_scl.output();
+    m_sda.output();
+    delay_t2();
+    m_scl.input();
+    delay_t1();
+    m_sda.input();
+    m_start = false;
+    return (m_sda && m_scl);
+  }
+
+  /**
+   * Start given transaction. The transaction is performed in the
+   * background; one clock phase (half bit) per call of tick(). Use
+   * await() or the transaction callback for completion. The
+   * sketch should call tick() from a timer interrupt with twice the
+   * bit rate, e.g. AVR Timer1 compare match.
+   * @code
+   * ISR(TIMER1_COMPA_vect) { twi.tick(); }
+   * @endcode
+   * Return true(1) if successful otherwise false(0).
+   * @param[in] tp transaction pointer.
+   * @return bool.
+   */
+  bool start(transaction_t* tp)
+  {
+    // Acquire bus; the lock is released on completion
+    lock();
+    tp->result = 0;
+    tp->completed = false;
+    uint8_t key = disable();
+    begin(tp);
+    restore(key);
+    return (true);
+  }
+
+  /**
+   * @override{TWI}
+   * Dispatch queued transactions. Start the first transaction in
+   * the queue if the bus is idle. The following transactions are
+   * started by tick() on completion.
+   */
+  virtual void dispatch()
+  {
+    uint8_t key = disable();
+    if (m_put != m_get && try_lock()) begin(dequeue());
+    restore(key);
+  }
+
+  /**
+   * Transaction state machine; perform one clock phase (half bit)
+   * of the current transaction. Should be called from a timer
+   * interrupt with twice the bit rate. The data signal is changed
+   * when the clock is pulled low, a tick before the clock is
+   * released, and sampled with the clock high. A device stretching
+   * the clock delays the state machine.
+   */
+  void tick()
+  {
+    switch (m_state) {
+    case IDLE_STATE:
+      break;
+    case START_STATE:
+      // Start condition; wait if the bus is used by another master
+      if (m_scl == 0 || m_sda == 0) {
+	m_stretch = 0;
+	m_wait = 0;
+	m_state = BUS_IDLE_STATE;
+	break;
+      }
+      // Fall through
+    case REP_START_DATA_STATE:
+      // Clock high; pull data low
+      m_sda.output();
+      m_state = ADDRESS_STATE;
+      break;
+    case ADDRESS_STATE:
+      // Clock low; address device with write or read request
+      m_scl.output();
+      load(m_tp->addr | (m_writing ? 0 : 1), false);
+      m_addressing = true;
+      data();
+      break;
+    case LOW_STATE:
+      // Clock low; data bit set on the previous tick, release clock
+      m_scl.input();
+      m_stretch = 0;
+      m_state = HIGH_STATE;
+      break;
+    case HIGH_STATE:
+      // Clock high; allow clock stretching, sample data and pull clock low
+      if (CLOCK_STRETCHING && m_scl == 0) {
+	if (++m_stretch < CLOCK_STRETCHING_TICK_MAX) break;
+	m_result = E_STRETCH_TIMEOUT;
+	m_bit = 0;
+	m_state = RECOVER_STATE;
+	break;
+      }
+      {
+	bool value = m_sda;
+	if (m_bit < 8 && !m_rx && (m_byte & 0x80) && !value) {
+	  // Arbitration lost; bus released, retry when free
+	  if (arbitration_lost(m_retry)) {
+	    m_retry += 1;
+	    m_stretch = 0;
+	    m_wait = 0;
+	    m_state = BUS_IDLE_STATE;
+	  }
+	  else {
+	    m_result = E_ARB_LOST;
+	    complete();
+	  }
+	  break;
+	}
+	m_scl.output();
+	m_state = LOW_STATE;
+	if (m_bit < 8) {
+	  m_byte = (m_byte << 1) | (m_rx && value);
+	  m_bit += 1;
+	}
+	else {
+	  advance(!m_rx && value);
+	}
+	if (m_state == LOW_STATE) data();
+      }
+      break;
+    case REP_START_STATE:
+      // Clock low; release data
+      m_sda.input();
+      m_state = REP_START_HIGH_STATE;
+      break;
+    case REP_START_HIGH_STATE:
+      // Release clock; repeated start condition on next tick
+      m_scl.input();
+      m_state = REP_START_DATA_STATE;
+      break;
+    case STOP_STATE:
+      // Clock low; pull data low
+      m_sda.output();
+      m_state = STOP_HIGH_STATE;
+      break;
+    case STOP_HIGH_STATE:
+      // Release clock
+      m_scl.input();
+      m_state = STOP_DONE_STATE;
+      break;
+    case STOP_DONE_STATE:
+      // Clock high; release data for stop condition
+      m_sda.input();
+      complete();
+      break;
+    case BUS_IDLE_STATE:
+      // Wait for clock and data released for the bus idle time;
+      // doubled for each retry after arbitration loss
+      if (m_scl == 0 || m_sda == 0)
+	m_stretch = 0;
+      else if (++m_stretch == (BUS_IDLE_TICKS << m_retry)) {
+	begin(m_tp, m_retry);
+	break;
+      }
+      if (++m_wait == BUS_IDLE_TICK_MAX) {
+	m_result = E_TIMEOUT;
+	m_bit = 0;
+	m_state = RECOVER_STATE;
+      }
+      break;
+    case RECOVER_STATE:
+      // Nine clock pulses with data released, then stop condition
+      m_sda.input();
+      if (m_bit & 1) m_scl.input(); else m_scl.output();
+      if (++m_bit == 19) m_state = STOP_STATE;
+      break;
+    }
+  }
+
+protected:
+  /** Transaction state machine states; see tick(). */
+  enum {
+    IDLE_STATE,			//!< No transaction.
+    START_STATE,		//!< Start condition when bus free.
+    ADDRESS_STATE,		//!< Clock low and address byte.
+    LOW_STATE,			//!< Clock low; release clock.
+    HIGH_STATE,			//!< Clock high; sample data.
+    REP_START_STATE,		//!< Release data for repeated start.
+    REP_START_HIGH_STATE,	//!< Release clock for repeated start.
+    REP_START_DATA_STATE,	//!< Pull data low for repeated start.
+    STOP_STATE,			//!< Pull data low for stop condition.
+    STOP_HIGH_STATE,		//!< Release clock for stop condition.
+    STOP_DONE_STATE,		//!< Release data; transaction completed.
+    BUS_IDLE_STATE,		//!< Wait for bus free.
+    RECOVER_STATE		//!< Bus recovery after timeout.
+  } __attribute__((packed));
+
+  /** Maximum number of clock stretching ticks: ten bits. */
+  static const uint8_t CLOCK_STRETCHING_TICK_MAX = 20;
+
+  /** Bus idle ticks before start condition: two bits. */
+  static const uint8_t BUS_IDLE_TICKS = 4;
+
+  /** Maximum number of ticks to wait for the bus to be free. */
+  static const uint16_t BUS_IDLE_TICK_MAX = 2000;
+
+  /** Start condition and clock high delay time (us); see Timing. */
+  static const int T1 = Timing<FREQ>::T1;
+
+  /** Basic clock delay time (us); see Timing. */
+  static const int T2 = Timing<FREQ>::T2;
+
+  /** Bus idle time after arbitration loss: two clock periods (us) */
+  static const int BUS_IDLE_TIME = 2 * (T1 + T2) + 1;
+
+  /** Clock frequency (Hz); template parameter or measured. */
+  uint32_t m_freq;
+
+  /** Data signal pin. */
+  GPIO<SDA_PIN> m_sda;
+
+  /** Clock signal pin. */
+  GPIO<SCL_PIN> m_scl;
+
+  /** Transaction state; start or repeated start condition. */
+  bool m_start;
+
+  /** Arbitration lost; data released but read low. */
+  bool m_lost;
+
+  /** Transfer timeout expired. */
+  bool m_expired;
+
+  /** Current asynchronous transaction. */
+  transaction_t* volatile m_tp;
+
+  /** State of transaction state machine. */
+  volatile uint8_t m_state;
+
+  /** Write phase of current transaction. */
+  bool m_writing;
+
+  /** Receiving data byte (otherwise address or data write). */
+  bool m_rx;
+
+  /** Address byte of current phase. */
+  bool m_addressing;
+
+  /** Current byte shift register. */
+  uint8_t m_byte;
+
+  /** Current bit; 0..7 data, 8 acknowledge. */
+  uint8_t m_bit;
+
+  /** Number of clock stretching or bus idle ticks. */
+  uint8_t m_stretch;
+
+  /** Number of ticks waiting for the bus to be free. */
+  uint16_t m_wait;
+
+  /** Number of retries of current transaction after arbitration loss. */
+  uint8_t m_retry;
+
+  /** Current io vector segment (write phase). */
+  iovec_t* m_vp;
+
+  /** Current buffer pointer. */
+  uint8_t* m_bp;
+
+  /** Remaining bytes in current buffer. */
+  size_t m_size;
+
+  /** Number of bytes transferred in current phase. */
+  int m_count;
+
+  /** Result of current transaction. */
+  int m_result;
+
+  /**
+   * Initiate state machine for given transaction; start condition
+   * on next tick. The bus should be locked by the caller.
+   * @param[in] tp transaction pointer.
+   * @param[in] retry number of retries after arbitration loss
+   * (default 0).
+   */
+  void begin(transaction_t* tp, uint8_t retry = 0)
+  {
+    m_tp = tp;
+    m_retry = retry;
+    m_writing = (tp->vp != NULL) || (tp->count == 0);
+    m_vp = tp->vp;
+    m_bp = (uint8_t*) tp->buf;
+    m_size = m_writing ? 0 : tp->count;
+    m_count = 0;
+    m_sda.input();
+    m_scl.input();
+    m_state = START_STATE;
+  }
+
+  /**
+   * Load given byte for transfer, clock low. The byte is written,
+   * or received when rx is true.
+   * @param[in] byte to write.
+   * @param[in] rx receive byte.
+   */
+  void load(uint8_t byte, bool rx)
+  {
+    m_byte = byte;
+    m_bit = 0;
+    m_rx = rx;
+    m_state = LOW_STATE;
+  }
+
+  /**
+   * Set data signal for the next data or acknowledge bit, clock low.
+   * The data signal is set a tick before the clock is released to
+   * give the data setup time.
+   */
+  void data()
+  {
+    if (m_bit < 8) {
+      if (m_rx || (m_byte & 0x80)) m_sda.input(); else m_sda.output();
+    }
+    else {
+      if (m_rx && m_size != 0) m_sda.output(); else m_sda.input();
+    }
+  }
+
+  /**
+   * Byte completed; continue with next byte, repeated start for the
+   * read phase or stop condition.
+   * @param[in] nack from device (write).
+   */
+  void advance(bool nack)
+  {
+    if (nack) {
+      if (m_addressing) {
+	m_result = E_ADDR_NACK;
+      }
+      else {
+	m_result = E_DATA_NACK;
+	m_acked = m_count - 1;
+      }
+      m_state = STOP_STATE;
+      return;
+    }
+    m_addressing = false;
+    if (m_rx) {
+      *m_bp++ = m_byte;
+      m_count += 1;
+    }
+    if (m_writing) {
+      // Write next byte from io vector
+      while (m_size == 0 && m_vp != NULL && m_vp->buf != NULL) {
+	m_bp = (uint8_t*) m_vp->buf;
+	m_size = m_vp->size;
+	m_vp++;
+      }
+      if (m_size != 0) {
+	load(*m_bp++, false);
+	m_size -= 1;
+	m_count += 1;
+	return;
+      }
+      // Write completed; check for read with repeated start condition
+      if (m_tp->count == 0) {
+	m_result = m_count;
+	m_state = STOP_STATE;
+	return;
+      }
+      m_writing = false;
+      m_bp = (uint8_t*) m_tp->buf;
+      m_size = m_tp->count;
+      m_count = 0;
+      m_state = REP_START_STATE;
+      return;
+    }
+    // Read next byte; acknowledge until last byte
+    if (m_size != 0) {
+      load(0, true);
+      m_size -= 1;
+      return;
+    }
+    m_result = m_count;
+    m_state = STOP_STATE;
+  }
+
+  /**
+   * Complete current transaction with the result and call the
+   * transaction callback. Continue with the next queued transaction,
+   * otherwise release bus.
+   */
+  void complete()
+  {
+    transaction_t* tp = m_tp;
+    int res = m_result;
+    transaction_t* next = dequeue();
+    if (next != NULL) {
+      begin(next);
+    }
+    else {
+      m_tp = NULL;
+      m_state = IDLE_STATE;
+      unlock();
+    }
+    notify(tp, res);
+  }
+
+  /**
+   * Delay start condition and clock high time. No delay when the
+   * time is zero (resolved at compile time).
+   */
+  static void delay_t1()
+  {
+    if (T1 != 0) delayMicroseconds(T1);
+  }
+
+  /**
+   * Delay basic clock time. No delay when the time is zero
+   * (resolved at compile time).
+   */
+  static void delay_t2()
+  {
+    if (T2 != 0) delayMicroseconds(T2);
+  }
+
+  /**
+   * Allow device to stretch clock signal; bounded by the transfer
+   * timeout. Return true(1) if successful otherwise false(0).
+   * @return bool.
+   */
+  bool clock_stretching()
+  {
+    if (!CLOCK_STRETCHING || m_scl) return (true);
+    uint32_t start = millis();
+    while (!m_scl) {
+      if (m_timeout != 0 && millis() - start >= m_timeout) {
+	m_expired = true;
+	return (false);
+      }
+    }
+    return (true);
+  }
+
+  /**
+   * Return error code for the last failed bit transfer or condition;
+   * clock stretching timeout, arbitration lost or bus error (data
+   * signal held low).
+   * @return negative error code.
+   */
+  int error()
+  {
+    if (m_expired) return (E_STRETCH_TIMEOUT);
+    if (m_lost) return (E_ARB_LOST);
+    return (E_BUS_ERROR);
+  }
+
+  /**
+   * Read data from device with given address into given io vector
+   * buffers; single attempt.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes read or negative error code.
+   */
+  int receive(uint8_t addr, iovec_t* vp)
   {
     // Check if repeated start condition should be generated
-    if (!m_start && !repeated_start_condition()) return (-1);
+    if (!m_start && !repeated_start_condition()) return (error());
     m_start = false;
 
     // Address device with read request and check that it acknowledges
     bool nack;
-    if (!write_byte(addr | 1, nack) || nack) return (-1);
-
-    // Read bytes and acknowledge until required size
-    uint8_t* bp = (uint8_t*) buf;
-    size_t size = count;
-    while (size--) {
-      bool ack = (size != 0);
-      uint8_t data;
-      if (!read_byte(data, ack)) return (-1);
-      *bp++ = data;
+    if (!write_byte(addr | 1, nack)) return (error());
+    if (nack) return (E_ADDR_NACK);
+
+    // Read bytes into io vector buffers; acknowledge until last byte
+    size_t count = ::TWI::iovec_size(vp);
+    size_t left = count;
+    for(; vp->buf != NULL; vp++) {
+      uint8_t* bp = (uint8_t*) vp->buf;
+      size_t size = vp->size;
+      while (size--) {
+	bool ack = (--left != 0);
+	uint8_t data;
+	if (!read_byte(data, ack)) return (error());
+	*bp++ = data;
+      }
     }
     return (count);
   }
 
   /**
-   * @override{TWI}
-   * Write data to device with from given io vector.
+   * Write data to device with from given io vector; single attempt.
    * @param[in] addr device address.
    * @param[in] vp io vector pointer.
    * @return number of bytes written or negative error code.
    */
-  virtual int write(uint8_t addr, iovec_t* vp)
+  int transmit(uint8_t addr, iovec_t* vp)
   {
     // Check if repeated start condition should be generated
-    if (!m_start && !repeated_start_condition()) return (-1);
+    if (!m_start && !repeated_start_condition()) return (error());
     m_start = false;
 
     // Address device with write request and check that it acknowledges
     bool nack;
-    if (!write_byte(addr | 0, nack) || nack) return (-1);
+    if (!write_byte(addr | 0, nack)) return (error());
+    if (nack) return (E_ADDR_NACK);
     if (vp == NULL) return (0);
 
     // Write given io vector buffers to device
     int count = 0;
+    m_acked = 0;
     for(; vp->buf != NULL; vp++) {
       const uint8_t* bp = (const uint8_t*) vp->buf;
       size_t size = vp->size;
       count += size;
       while (size--) {
 	uint8_t data = *bp++;
-	if (!write_byte(data, nack) || nack) return (-1);
+	if (!write_byte(data, nack)) return (error());
+	if (nack) return (E_DATA_NACK);
+	m_acked += 1;
       }
     }
     return (count);
   }
 
-protected:
-  /** Start condition delay time: 4.0 us (100 kHz) */
-  static const int T1 = 4;
-
-  /** Basic clock delay time: 4.7 us (100 kHz) */
-  static const int T2 = 5;
-
-  /** Maximum number of clock stretching retries: 100 us */
-  static const int CLOCK_STRETCHING_RETRY_MAX = 25;
-
-  /** Data signal pin. */
-  GPIO<SDA_PIN> m_sda;
-
-  /** Clock signal pin. */
-  GPIO<SCL_PIN> m_scl;
-
-  /** Transaction state; start or repeated start condition. */
-  bool m_start;
-
   /**
-   * Allow device to stretch clock signal. Return true(1) if
-   * successful otherwise false(0).
+   * Wait for the bus to be free after arbitration loss or when busy
+   * on acquire() and generate start condition. The bus is free when
+   * clock and data have been released for the bus idle time;
+   * doubled for each retry. The wait is bounded by the transfer
+   * timeout. Return true(1) if successful otherwise false(0).
+   * @param[in] retry number of retries so far.
    * @return bool.
    */
-  bool clock_stretching()
+  bool restart(uint8_t retry)
   {
-    for (int retry = 0; retry < CLOCK_STRETCHING_RETRY_MAX; retry++) {
-      if (m_scl) return (true);
-      delayMicroseconds(T1);
+    uint32_t time = (uint32_t) BUS_IDLE_TIME << retry;
+    uint32_t start = micros();
+    uint32_t idle = start;
+    while (1) {
+      uint32_t now = micros();
+      if (m_scl == 0 || m_sda == 0)
+	idle = now;
+      else if (now - idle >= time)
+	break;
+      if (m_timeout != 0 && now - start >= m_timeout * 1000UL)
+	return (false);
     }
-    return (false);
+    m_start = start_condition();
+    return (m_start);
   }
 
   /**
@@ -174,25 +774,25 @@ protected:
     m_sda.input();
     if (m_sda == 0) return (false);
     m_sda.output();
-    delayMicroseconds(T1);
+    delay_t1();
     m_scl.output();
     return (true);
   }
 
   /**
-   * Generate repeated start condition. Return true(1) if successful otherwise
-   * false(0).
+   * Generate repeated start condition. Return true(1) if successful
+   * otherwise false(0).
    * @return bool.
    */
   bool repeated_start_condition()
   {
-    delayMicroseconds(T1);
+    delay_t1();
     m_sda.input();
     if (m_sda == 0) return (false);
     m_scl.input();
-    delayMicroseconds(T2);
+    delay_t2();
     m_sda.output();
-    delayMicroseconds(T1);
+    delay_t1();
     m_scl.output();
     return (true);
   }
@@ -204,13 +804,13 @@ protected:
    */
   bool stop_condition()
   {
-    delayMicroseconds(T1);
+    delay_t1();
     m_sda.output();
     m_scl.input();
-    delayMicroseconds(T1);
+    delay_t1();
     if (!clock_stretching()) return (false);
     m_sda.input();
-    return (m_sda == 0);
+    return (m_sda != 0);
   }
 
   /**
@@ -222,9 +822,9 @@ protected:
   bool write_bit(bool value)
   {
     if (value) m_sda.input(); else m_sda.output();
-    delayMicroseconds(T2);
+    delay_t2();
     m_scl.input();
-    delayMicroseconds(T1);
+    delay_t1();
     if (!clock_stretching()) return (false);
     m_scl.output();
     return (true);
@@ -239,47 +839,107 @@ protected:
   bool read_bit(bool& value)
   {
     m_sda.input();
-    delayMicroseconds(T2);
+    delay_t2();
     m_scl.input();
-    delayMicroseconds(T1);
+    delay_t1();
     if (!clock_stretching()) return (false);
     value = m_sda;
     m_scl.output();
     return (true);
   }
 
+  /**
+   * Write data bit given by mask to device. Clock stretching is
+   * checked when STRETCH is true. A released data signal that reads
+   * low means that another master has won the bus; arbitration
+   * lost and the clock is left released. Return true(1) if
+   * successful otherwise false(0).
+   * @param[in] MASK data bit mask.
+   * @param[in] STRETCH check clock stretching.
+   * @param[in] byte to write to device.
+   * @return bool.
+   */
+  template<uint8_t MASK, bool STRETCH>
+  bool write_data(uint8_t byte)
+  {
+    if (byte & MASK) m_sda.input(); else m_sda.output();
+    delay_t2();
+    m_scl.input();
+    delay_t1();
+    if (STRETCH && !clock_stretching()) return (false);
+    if ((byte & MASK) && m_sda == 0) {
+      m_lost = true;
+      return (false);
+    }
+    m_scl.output();
+    return (true);
+  }
+
+  /**
+   * Read data bit given by mask from device. The data signal should
+   * be released. Clock stretching is checked when STRETCH is true.
+   * Return true(1) if successful otherwise false(0).
+   * @param[in] MASK data bit mask.
+   * @param[in] STRETCH check clock stretching.
+   * @param[in,out] byte read from device.
+   * @return bool.
+   */
+  template<uint8_t MASK, bool STRETCH>
+  bool read_data(uint8_t& byte)
+  {
+    delay_t2();
+    m_scl.input();
+    delay_t1();
+    if (STRETCH && !clock_stretching()) return (false);
+    if (m_sda) byte |= MASK;
+    m_scl.output();
+    return (true);
+  }
+
   /**
    * Write byte to device. Return true(1) and nack bit if successful
-   * otherwise false(0).
+   * otherwise false(0). The bits are unrolled. Devices stretch the
+   * clock between bytes; this is checked on the first data bit and
+   * the acknowledge bit only. The write stops on arbitration loss.
    * @param[in] byte to write to device.
    * @param[out] nack from device.
    * @return bool.
    */
   bool write_byte(uint8_t byte, bool& nack)
   {
-    for (int i = 0; i < 8; i++) {
-      if (!write_bit(byte & 0x80)) return (false);
-      byte <<= 1;
-    }
+    if (!write_data<0x80, true>(byte)
+	|| !write_data<0x40, false>(byte)
+	|| !write_data<0x20, false>(byte)
+	|| !write_data<0x10, false>(byte)
+	|| !write_data<0x08, false>(byte)
+	|| !write_data<0x04, false>(byte)
+	|| !write_data<0x02, false>(byte)
+	|| !write_data<0x01, false>(byte))
+      return (false);
     return (read_bit(nack));
   }
 
   /**
    * Read byte to device. Return true(1) if successful otherwise
    * false(0). The parameter ack signals if additional read with
-   * follow.
+   * follow. The bits are unrolled and clock stretching is checked
+   * on the first data bit and the acknowledge bit only.
    * @param[in] byte to write to device.
    * @param[out] ack to device.
    * @return bool.
    */
   bool read_byte(uint8_t& byte, bool ack)
   {
-    bool value;
     byte = 0;
-    for (int i = 0; i < 8; i++) {
-      if (!read_bit(value)) return (false);
-      byte = (byte << 1) | value;
-    }
+    m_sda.input();
+    if (!read_data<0x80, true>(byte)) return (false);
+    read_data<0x40, false>(byte);
+    read_data<0x20, false>(byte);
+    read_data<0x10, false>(byte);
+    read_data<0x08, false>(byte);
+    read_data<0x04, false>(byte);
+    read_data<0x02, false>(byte);
+    read_data<0x01, false>(byte);
     return (write_bit(!ack));
   }
 };
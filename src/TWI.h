@@ -28,7 +28,243 @@
 class TWI {
 public:
   /**
-   * Abstract Two-Wire Interface Device Driver class.
+   * Transaction descriptor for asynchronous bus managers. The io
+   * vector (if any) is written to the device, followed by a repeated
+   * start condition and read of the given number of bytes into the
+   * buffer (if any). An address only write (probe) is issued when
+   * both io vector and read count are empty.
+   */
+  struct transaction_t {
+    uint8_t addr;		//!< Device address (write).
+    iovec_t* vp;		//!< Write io vector or NULL.
+    void* buf;			//!< Read buffer pointer or NULL.
+    size_t count;		//!< Read buffer size in bytes.
+    void (*callback)(transaction_t* tp); //!< Completion callback or NULL.
+    void* env;			//!< Callback environment.
+    volatile int result;	//!< Number of bytes or negative error code.
+    volatile bool completed;	//!< Completion flag.
+  };
+
+  /**
+   * Bus manager lock priority levels. Requests are granted in
+   * priority order and in request order within a level.
+   */
+  enum {
+    HIGH_PRIORITY = 0,		//!< Latency sensitive devices.
+    NORMAL_PRIORITY = 1,	//!< Default priority.
+    LOW_PRIORITY = 2,		//!< Bulk transfers.
+    PRIORITY_MAX = 3		//!< Number of priority levels.
+  };
+
+  /**
+   * Error codes; negative results of transfers. A device that is
+   * busy (e.g. measuring or writing) does not acknowledge the
+   * address; the transfer may be retried directly. Bus errors and
+   * timeouts should not be retried blindly.
+   */
+  enum {
+    E_ADDR_NACK = -1,		//!< Address not acknowledged; busy or missing.
+    E_TIMEOUT = -2,		//!< Transfer timeout; bus recovered.
+    E_DATA_NACK = -3,		//!< Data not acknowledged; see acknowledged().
+    E_ARB_LOST = -4,		//!< Arbitration lost to another master.
+    E_BUS_ERROR = -5,		//!< Bus error; misplaced start/stop condition.
+    E_STRETCH_TIMEOUT = -6	//!< Clock held low by device; bus recovered.
+  };
+
+  /**
+   * Device bus statistics. Collected per device when the library is
+   * built with TWI_STATISTICS defined.
+   */
+  struct statistics_t {
+    uint32_t transactions;	//!< Number of acquired transactions.
+    uint32_t bytes_read;	//!< Number of bytes read.
+    uint32_t bytes_written;	//!< Number of bytes written.
+    uint16_t nacks;		//!< Number of not acknowledged transfers.
+    uint16_t timeouts;		//!< Number of transfer timeouts.
+    uint16_t errors;		//!< Number of arbitration and bus errors.
+    uint16_t retries;		//!< Number of driver retries.
+    uint32_t hold_time;		//!< Accumulated bus hold time (us).
+    uint32_t wait_time;		//!< Accumulated bus lock wait time (us).
+    uint32_t wait_max;		//!< Maximum bus lock wait time (us).
+  };
+
+  /**
+   * Latency histogram with log2 buckets. Bucket zero counts times
+   * below 2 us, bucket n times from 2^n to 2^(n+1)-1 us, and the
+   * last bucket all longer times. Bucket counters saturate.
+   * Recorded per bus manager when the library is built with
+   * TWI_HISTOGRAM defined.
+   */
+  class Histogram {
+  public:
+    /** Number of buckets. */
+    static const uint8_t BUCKET_MAX = 16;
+
+    /**
+     * Construct empty histogram.
+     */
+    Histogram()
+    {
+      reset();
+    }
+
+    /**
+     * Reset bucket counters.
+     */
+    void reset()
+    {
+      uint8_t key = disable();
+      memset(m_bucket, 0, sizeof(m_bucket));
+      restore(key);
+    }
+
+    /**
+     * Record given time.
+     * @param[in] us micro-seconds.
+     */
+    void record(uint32_t us)
+    {
+      uint8_t ix = 0;
+      while ((us >>= 1) != 0 && ix < BUCKET_MAX - 1) ix++;
+      if (m_bucket[ix] != 0xffff) m_bucket[ix] += 1;
+    }
+
+    /**
+     * Return counter for given bucket.
+     * @param[in] ix bucket index (0..BUCKET_MAX-1).
+     * @return counter.
+     */
+    uint16_t operator[](uint8_t ix) const
+    {
+      return (ix < BUCKET_MAX ? m_bucket[ix] : 0);
+    }
+
+    /**
+     * Return lower time limit for given bucket.
+     * @param[in] ix bucket index (0..BUCKET_MAX-1).
+     * @return micro-seconds.
+     */
+    static uint32_t limit(uint8_t ix)
+    {
+      return (ix == 0 ? 0 : 1UL << ix);
+    }
+
+  protected:
+    /** Bucket counters. */
+    uint16_t m_bucket[BUCKET_MAX];
+  };
+
+  /**
+   * Retry policy for device driver transfers; maximum number of
+   * attempts, delay between attempts (fixed or doubled for each
+   * attempt), yield or busy-wait during the delay, and the error
+   * codes that are retried. The default policy is a single attempt.
+   */
+  class Retry {
+  public:
+    /** Mode flags. */
+    enum {
+      FIXED = 0,		//!< Fixed delay between attempts.
+      EXPONENTIAL = 1,		//!< Delay doubled for each attempt.
+      SPIN = 0,			//!< Busy-wait during delay.
+      YIELD = 2			//!< Yield during delay.
+    };
+
+    /**
+     * Construct retry policy with given maximum number of attempts,
+     * delay, mode and retried errors.
+     * @param[in] attempts maximum number of attempts (default 1).
+     * @param[in] backoff delay between attempts (us, default 0).
+     * @param[in] mode flags (default FIXED | YIELD).
+     * @param[in] errors mask of retried error codes (default
+     * address not acknowledged; device busy, and arbitration lost).
+     */
+    Retry(uint8_t attempts = 1,
+	  uint16_t backoff = 0,
+	  uint8_t mode = FIXED | YIELD,
+	  uint8_t errors = mask(E_ADDR_NACK) | mask(E_ARB_LOST)) :
+      m_attempts(attempts == 0 ? 1 : attempts),
+      m_mode(mode),
+      m_errors(errors),
+      m_backoff(backoff)
+    {
+    }
+
+    /**
+     * Return error mask for given error code.
+     * @param[in] err negative error code.
+     * @return mask.
+     */
+    static uint8_t mask(int err)
+    {
+      return ((err < 0 && err >= -8) ? (1 << (-1 - err)) : 0);
+    }
+
+    /**
+     * Return maximum number of attempts.
+     * @return attempts.
+     */
+    uint8_t attempts() const
+    {
+      return (m_attempts);
+    }
+
+    /**
+     * Return true(1) if the given error code should be retried
+     * otherwise false(0).
+     * @param[in] err negative error code.
+     * @return bool.
+     */
+    bool retryable(int err) const
+    {
+      return ((m_errors & mask(err)) != 0);
+    }
+
+    /**
+     * Return true(1) if a failed attempt with given number and error
+     * code should be retried otherwise false(0).
+     * @param[in] attempt number of attempts so far (1..).
+     * @param[in] err negative error code.
+     * @return bool.
+     */
+    bool retry(uint8_t attempt, int err) const
+    {
+      return (attempt < m_attempts && retryable(err));
+    }
+
+    /**
+     * Delay after given attempt.
+     * @param[in] attempt number of attempts so far (1..).
+     */
+    void wait(uint8_t attempt) const
+    {
+      uint32_t us = m_backoff;
+      if (us == 0) return;
+      if (m_mode & EXPONENTIAL) us <<= (attempt > 16 ? 15 : attempt - 1);
+      uint32_t start = micros();
+      while (micros() - start < us)
+	if (m_mode & YIELD) yield();
+    }
+
+  protected:
+    /** Maximum number of attempts. */
+    uint8_t m_attempts;
+
+    /** Mode flags. */
+    uint8_t m_mode;
+
+    /** Mask of retried error codes. */
+    uint8_t m_errors;
+
+    /** Delay between attempts (us). */
+    uint16_t m_backoff;
+  };
+
+  /**
+   * Abstract Two-Wire Interface Device Driver class. Transactions
+   * are serialized between device driver instances with the bus
+   * manager lock and may be nested within an instance; each task
+   * should use its own device driver instance.
    */
   class Device {
   public:
@@ -38,86 +274,853 @@ public:
      * @param[in] twi bus manager.
      * @param[in] addr device address.
      */
-    Device(TWI& twi, uint8_t addr) :
-      m_twi(twi),
-      m_addr(addr << 1)
+    Device(TWI& twi, uint8_t addr) :
+      m_twi(twi),
+      m_addr(addr << 1),
+      m_priority(NORMAL_PRIORITY)
+    {
+#if defined(TWI_STATISTICS)
+      memset(&m_statistics, 0, sizeof(m_statistics));
+#endif
+    }
+
+    /**
+     * Get retry policy for transfer().
+     * @return retry policy.
+     */
+    const Retry& retry() const
+    {
+      return (m_retry);
+    }
+
+    /**
+     * Set retry policy for transfer().
+     * @param[in] policy retry policy.
+     */
+    void retry(const Retry& policy)
+    {
+      m_retry = policy;
+    }
+
+    /**
+     * Get bus manager lock priority level.
+     * @return priority level.
+     */
+    uint8_t priority() const
+    {
+      return (m_priority);
+    }
+
+    /**
+     * Set bus manager lock priority level (HIGH_PRIORITY,
+     * NORMAL_PRIORITY or LOW_PRIORITY).
+     * @param[in] level priority level.
+     */
+    void priority(uint8_t level)
+    {
+      m_priority = (level < PRIORITY_MAX) ? level : (uint8_t) LOW_PRIORITY;
+    }
+
+#if defined(TWI_STATISTICS)
+    /**
+     * Copy device bus statistics to given snapshot and optionally
+     * reset the counters.
+     * @param[out] stats statistics snapshot.
+     * @param[in] reset counters (default false).
+     */
+    void statistics(statistics_t& stats, bool reset = false)
+    {
+      uint8_t key = disable();
+      stats = m_statistics;
+      if (reset) memset(&m_statistics, 0, sizeof(m_statistics));
+      restore(key);
+    }
+#endif
+
+    /**
+     * Start transaction. Wait for the bus manager lock and issue
+     * start condition. Transactions may be nested; when the bus is
+     * already acquired by the device the following transfers use
+     * repeated start conditions. Nesting is per device driver
+     * instance; tasks sharing an instance are not serialized. Return
+     * true(1) if successful otherwise false(0).
+     * @return bool.
+     */
+    bool acquire()
+    {
+      if (nested()) return (true);
+      lock();
+      if (m_twi.acquire()) return (acquired());
+      unlock();
+      return (false);
+    }
+
+    /**
+     * Start transaction. Wait at most the given time for the bus
+     * manager lock and issue start condition. Return true(1) if
+     * successful otherwise false(0) on timeout or error.
+     * @param[in] ms maximum lock wait time (milli-seconds).
+     * @return bool.
+     */
+    bool acquire(uint16_t ms)
+    {
+      if (nested()) return (true);
+      if (!lock(ms)) return (false);
+      if (m_twi.acquire()) return (acquired());
+      unlock();
+      return (false);
+    }
+
+    /**
+     * Stop transaction. Issue stop condition and release the bus
+     * manager lock on the outermost release of nested transactions.
+     * The bus and lock are left as is if the device has not acquired
+     * the bus. Return true(1) if successful otherwise false(0).
+     * @return bool.
+     */
+    bool release()
+    {
+      if (m_twi.m_owner != this) return (false);
+      if (unnested()) return (true);
+      bool res = m_twi.release();
+      released();
+      unlock();
+      return (res);
+    }
+
+    /**
+     * Read data from device to given buffer.
+     * @param[in] buf buffer pointer.
+     * @param[in] count buffer size in bytes.
+     * @return number of bytes read or negative error code.
+     */
+    int read(void* buf, size_t count)
+    {
+      transfer_start();
+      return (counted_read(m_twi.read(m_addr, buf, count)));
+    }
+
+    /**
+     * Read data from device into given io vector buffers.
+     * @param[in] vp io vector pointer.
+     * @return number of bytes read or negative error code.
+     */
+    int read(iovec_t* vp)
+    {
+      transfer_start();
+      return (counted_read(m_twi.read(m_addr, vp)));
+    }
+
+    /**
+     * Write data from the given buffer to device.
+     * @param[in] buf buffer pointer.
+     * @param[in] count buffer size in bytes.
+     * @return number of bytes written or negative error code.
+     */
+    int write(const void* buf, size_t count)
+    {
+      transfer_start();
+      return (counted_write(m_twi.write(m_addr, buf, count)));
+    }
+
+    /**
+     * Write data to device with from given io vector.
+     * @param[in] vp io vector pointer.
+     * @return number of bytes written or negative error code.
+     */
+    int write(iovec_t* vp)
+    {
+      transfer_start();
+      return (counted_write(m_twi.write(m_addr, vp)));
+    }
+
+    /**
+     * Write data to device from given io vector and read response
+     * into given buffer (repeated start condition).
+     * @param[in] vp io vector pointer.
+     * @param[in] buf buffer pointer.
+     * @param[in] count buffer size in bytes.
+     * @return number of bytes read or negative error code.
+     */
+    int write_read(iovec_t* vp, void* buf, size_t count)
+    {
+      transfer_start();
+      return (counted_write_read(vp, m_twi.write_read(m_addr, vp, buf, count)));
+    }
+
+    /**
+     * Write data to device from given source buffer and read
+     * response into given buffer (repeated start condition).
+     * @param[in] src source buffer pointer.
+     * @param[in] size source buffer size in bytes.
+     * @param[in] buf buffer pointer.
+     * @param[in] count buffer size in bytes.
+     * @return number of bytes read or negative error code.
+     */
+    int write_read(const void* src, size_t size, void* buf, size_t count)
+    {
+      iovec_t vec[2];
+      iovec_t* vp = vec;
+      iovec_arg(vp, src, size);
+      iovec_end(vp);
+      transfer_start();
+      return (counted_write_read(vec, m_twi.write_read(m_addr, vec, buf, count)));
+    }
+
+    /**
+     * Read register with given internal address into given buffer.
+     * The internal address is written most significant byte first
+     * followed by a repeated start condition and the read.
+     * @param[in] reg internal register address.
+     * @param[in] size internal address size in bytes (1..3).
+     * @param[in] buf buffer pointer.
+     * @param[in] count buffer size in bytes.
+     * @return number of bytes read or negative error code.
+     */
+    int read_register(uint32_t reg, uint8_t size, void* buf, size_t count)
+    {
+      transfer_start();
+      return (counted_register(size, m_twi.read_register(m_addr, reg, size, buf, count)));
+    }
+
+    /**
+     * Read register with given 8-bit internal address into given
+     * buffer.
+     * @param[in] reg internal register address.
+     * @param[in] buf buffer pointer.
+     * @param[in] count buffer size in bytes.
+     * @return number of bytes read or negative error code.
+     */
+    int read_register(uint8_t reg, void* buf, size_t count)
+    {
+      return (read_register((uint32_t) reg, 1, buf, count));
+    }
+
+    /**
+     * Perform transaction; write data from given io vector (if any)
+     * and read into given io vector buffers (if any) with repeated
+     * start condition. The transaction is retried according to the
+     * retry policy.
+     * @param[in] wp write io vector pointer or NULL.
+     * @param[in] rp read io vector pointer or NULL.
+     * @return number of bytes read (written when no read) or
+     * negative error code.
+     */
+    int transfer(iovec_t* wp, iovec_t* rp)
+    {
+      return (transfer(*this, wp, rp));
+    }
+
+    /**
+     * Wait for device to become ready; acknowledge polling. A device
+     * that is busy (e.g. measuring or writing) does not acknowledge
+     * its address. Issue an address only write (probe) with the given
+     * interval until acknowledged. Return true(1) if ready otherwise
+     * false(0) on timeout or error.
+     * @param[in] ms maximum wait time (milli-seconds).
+     * @param[in] us interval between probes (micro-seconds, default
+     * DEFAULT_POLL_INTERVAL).
+     * @return bool.
+     */
+    bool await_ready(uint16_t ms, uint16_t us = DEFAULT_POLL_INTERVAL)
+    {
+      return (await_ready(*this, ms, us));
+    }
+
+    /**
+     * Submit given transaction for device to the bus manager queue.
+     * Return true(1) if successful otherwise false(0) if the queue
+     * is full.
+     * @param[in] tp transaction pointer.
+     * @return bool.
+     */
+    bool submit(transaction_t* tp)
+    {
+      tp->addr = m_addr;
+      return (m_twi.submit(tp));
+    }
+
+  protected:
+    /** Two-Wire Interface Manager. */
+    TWI& m_twi;
+
+    /** Device address. */
+    uint8_t m_addr;
+
+    /** Bus manager lock priority level. */
+    uint8_t m_priority;
+
+    /** Retry policy for transfer(). */
+    Retry m_retry;
+
+#if defined(TWI_STATISTICS)
+    /** Device bus statistics. */
+    statistics_t m_statistics;
+#endif
+
+#if defined(TWI_STATISTICS) || defined(TWI_HISTOGRAM)
+    /** Start of bus hold time (us). */
+    uint32_t m_hold;
+#endif
+
+#if defined(TWI_HISTOGRAM)
+    /** Start of current transfer (us). */
+    uint32_t m_mark;
+#endif
+
+    /**
+     * Perform transaction with given device driver; shared by
+     * Device::transfer() and Driver<BUS>::transfer(). The device
+     * driver type selects virtual or static bus manager dispatch.
+     * @param[in] DEV device driver class.
+     * @param[in] dev device driver.
+     * @param[in] wp write io vector pointer or NULL.
+     * @param[in] rp read io vector pointer or NULL.
+     * @return number of bytes read (written when no read) or
+     * negative error code.
+     */
+    template<class DEV>
+    static int transfer(DEV& dev, iovec_t* wp, iovec_t* rp)
+    {
+      int res;
+      for (uint8_t attempt = 1;; attempt++) {
+	res = E_BUS_ERROR;
+	if (dev.acquire()) {
+	  res = 0;
+	  if (wp != NULL) res = dev.write(wp);
+	  if (res >= 0 && rp != NULL) res = dev.read(rp);
+	  if (!dev.release() && res >= 0) res = dev.m_twi.last_error();
+	}
+	if (res >= 0 || !dev.m_retry.retry(attempt, res)) break;
+	dev.retried();
+	dev.m_retry.wait(attempt);
+      }
+      return (res);
+    }
+
+    /**
+     * Wait for device to become ready with given device driver;
+     * shared by Device::await_ready() and Driver<BUS>::await_ready().
+     * @param[in] DEV device driver class.
+     * @param[in] dev device driver.
+     * @param[in] ms maximum wait time (milli-seconds).
+     * @param[in] us interval between probes (micro-seconds).
+     * @return bool.
+     */
+    template<class DEV>
+    static bool await_ready(DEV& dev, uint16_t ms, uint16_t us)
+    {
+      uint32_t start = millis();
+      while (1) {
+	if (!dev.acquire()) return (false);
+	int res = dev.write((iovec_t*) NULL);
+	if (!dev.release()) return (false);
+	if (res == 0) return (true);
+	if (res != E_ADDR_NACK) return (false);
+	if (millis() - start >= ms) return (false);
+	uint32_t mark = micros();
+	while (micros() - mark < us) yield();
+      }
+    }
+
+    /**
+     * Lock bus manager with device priority level.
+     */
+    void lock()
+    {
+#if defined(TWI_STATISTICS)
+      uint32_t start = micros();
+      m_twi.lock(m_priority);
+      uint32_t us = micros() - start;
+      m_statistics.wait_time += us;
+      if (us > m_statistics.wait_max) m_statistics.wait_max = us;
+#else
+      m_twi.lock(m_priority);
+#endif
+    }
+
+    /**
+     * Lock bus manager with device priority level and wait at most
+     * the given time. Return true(1) if successful otherwise
+     * false(0) on timeout.
+     * @param[in] ms maximum wait time (milli-seconds).
+     * @return bool.
+     */
+    bool lock(uint16_t ms)
+    {
+#if defined(TWI_STATISTICS)
+      uint32_t start = micros();
+      bool res = m_twi.lock(m_priority, ms);
+      uint32_t us = micros() - start;
+      m_statistics.wait_time += us;
+      if (us > m_statistics.wait_max) m_statistics.wait_max = us;
+      if (!res) m_statistics.timeouts += 1;
+      return (res);
+#else
+      return (m_twi.lock(m_priority, ms));
+#endif
+    }
+
+    /**
+     * Nested acquire; increment transaction depth if the bus is
+     * already acquired by the device. Return true(1) if nested
+     * otherwise false(0).
+     * @return bool.
+     */
+    bool nested()
+    {
+      if (m_twi.m_owner != this) return (false);
+      m_twi.m_depth += 1;
+      return (true);
+    }
+
+    /**
+     * Nested release; decrement transaction depth. Return true(1) if
+     * nested otherwise false(0) for the outermost release.
+     * @return bool.
+     */
+    bool unnested()
+    {
+      if (m_twi.m_owner != this || m_twi.m_depth <= 1) return (false);
+      m_twi.m_depth -= 1;
+      return (true);
+    }
+
+    /**
+     * Record acquired transaction, owner and start of bus hold time.
+     * Returns true(1).
+     * @return bool.
+     */
+    bool acquired()
+    {
+      m_twi.m_owner = this;
+      m_twi.m_depth = 1;
+#if defined(TWI_STATISTICS)
+      m_statistics.transactions += 1;
+#endif
+#if defined(TWI_STATISTICS) || defined(TWI_HISTOGRAM)
+      m_hold = micros();
+#endif
+      return (true);
+    }
+
+    /**
+     * Record end of transaction and bus hold time.
+     */
+    void released()
+    {
+      m_twi.m_owner = NULL;
+      m_twi.m_depth = 0;
+#if defined(TWI_STATISTICS) || defined(TWI_HISTOGRAM)
+      uint32_t us = micros() - m_hold;
+#endif
+#if defined(TWI_STATISTICS)
+      m_statistics.hold_time += us;
+#endif
+#if defined(TWI_HISTOGRAM)
+      m_twi.m_hold_histogram.record(us);
+#endif
+    }
+
+    /**
+     * Record start of transfer.
+     */
+    void transfer_start()
+    {
+#if defined(TWI_HISTOGRAM)
+      m_mark = micros();
+#endif
+    }
+
+    /**
+     * Record transfer time; time since the start of the transfer.
+     */
+    void transferred()
+    {
+#if defined(TWI_HISTOGRAM)
+      m_twi.m_transfer_histogram.record(micros() - m_mark);
+#endif
+    }
+
+    /**
+     * Record driver retry.
+     */
+    void retried()
+    {
+#if defined(TWI_STATISTICS)
+      m_statistics.retries += 1;
+#endif
+    }
+
+    /**
+     * Record failed transfer with given error code; not acknowledged,
+     * timeout or other bus error.
+     * @param[in] res negative error code.
+     */
+    void failed(int res)
+    {
+#if defined(TWI_STATISTICS)
+      switch (res) {
+      case E_ADDR_NACK:
+      case E_DATA_NACK:
+	m_statistics.nacks += 1;
+	break;
+      case E_TIMEOUT:
+      case E_STRETCH_TIMEOUT:
+	m_statistics.timeouts += 1;
+	break;
+      default:
+	m_statistics.errors += 1;
+      }
+#else
+      (void) res;
+#endif
+    }
+
+    /**
+     * Record read with given result. Returns the result.
+     * @param[in] res number of bytes read or negative error code.
+     * @return res.
+     */
+    int counted_read(int res)
+    {
+      transferred();
+#if defined(TWI_STATISTICS)
+      if (res < 0) failed(res); else m_statistics.bytes_read += res;
+#endif
+      return (res);
+    }
+
+    /**
+     * Record write with given result. Returns the result.
+     * @param[in] res number of bytes written or negative error code.
+     * @return res.
+     */
+    int counted_write(int res)
+    {
+      transferred();
+#if defined(TWI_STATISTICS)
+      if (res < 0) failed(res); else m_statistics.bytes_written += res;
+#endif
+      return (res);
+    }
+
+    /**
+     * Record register read with given internal address size and
+     * result. Returns the result.
+     * @param[in] size internal address size in bytes.
+     * @param[in] res number of bytes read or negative error code.
+     * @return res.
+     */
+    int counted_register(uint8_t size, int res)
+    {
+      transferred();
+#if defined(TWI_STATISTICS)
+      if (res < 0) {
+	failed(res);
+      }
+      else {
+	m_statistics.bytes_written += size;
+	m_statistics.bytes_read += res;
+      }
+#else
+      (void) size;
+#endif
+      return (res);
+    }
+
+    /**
+     * Record combined write and read of given io vector with given
+     * result. Returns the result.
+     * @param[in] vp io vector pointer.
+     * @param[in] res number of bytes read or negative error code.
+     * @return res.
+     */
+    int counted_write_read(const iovec_t* vp, int res)
+    {
+      transferred();
+#if defined(TWI_STATISTICS)
+      if (res < 0) {
+	failed(res);
+      }
+      else {
+	m_statistics.bytes_written += iovec_size(vp);
+	m_statistics.bytes_read += res;
+      }
+#else
+      (void) vp;
+#endif
+      return (res);
+    }
+
+    /**
+     * Unlock bus manager and dispatch any queued transactions.
+     */
+    void unlock()
+    {
+      m_twi.unlock();
+      if (m_twi.m_put != m_twi.m_get) m_twi.dispatch();
+    }
+  };
+
+  /**
+   * Static Two-Wire Interface Device Driver template class. Bus
+   * manager member functions are called without virtual dispatch
+   * and may be inlined. The specialization for the abstract bus
+   * manager (TWI) is the Device class.
+   * @param[in] BUS bus manager class.
+   */
+  template<class BUS>
+  class Driver : public Device {
+  public:
+    /**
+     * Construct Two-Wire Interface Device Driver with given bus and
+     * device address.
+     * @param[in] twi bus manager.
+     * @param[in] addr device address.
+     */
+    Driver(BUS& twi, uint8_t addr) :
+      Device(twi, addr)
+    {
+    }
+
+    /**
+     * Start transaction. Return true(1) if successful otherwise
+     * false(0).
+     * @return bool.
+     */
+    bool acquire()
+    {
+      if (nested()) return (true);
+      lock();
+      if (bus().BUS::acquire()) return (acquired());
+      unlock();
+      return (false);
+    }
+
+    /**
+     * Start transaction. Wait at most the given time for the bus
+     * manager lock. Return true(1) if successful otherwise false(0).
+     * @param[in] ms maximum lock wait time (milli-seconds).
+     * @return bool.
+     */
+    bool acquire(uint16_t ms)
+    {
+      if (nested()) return (true);
+      if (!lock(ms)) return (false);
+      if (bus().BUS::acquire()) return (acquired());
+      unlock();
+      return (false);
+    }
+
+    /**
+     * Stop transaction. Return true(1) if successful otherwise
+     * false(0).
+     * @return bool.
+     */
+    bool release()
+    {
+      if (m_twi.m_owner != this) return (false);
+      if (unnested()) return (true);
+      bool res = bus().BUS::release();
+      released();
+      unlock();
+      return (res);
+    }
+
+    /**
+     * Read data from device to given buffer.
+     * @param[in] buf buffer pointer.
+     * @param[in] count buffer size in bytes.
+     * @return number of bytes read or negative error code.
+     */
+    int read(void* buf, size_t count)
+    {
+      iovec_t vec[2];
+      iovec_t* vp = vec;
+      iovec_arg(vp, buf, count);
+      iovec_end(vp);
+      transfer_start();
+      return (counted_read(bus().BUS::read(m_addr, vec)));
+    }
+
+    /**
+     * Read data from device into given io vector buffers.
+     * @param[in] vp io vector pointer.
+     * @return number of bytes read or negative error code.
+     */
+    int read(iovec_t* vp)
+    {
+      transfer_start();
+      return (counted_read(bus().BUS::read(m_addr, vp)));
+    }
+
+    /**
+     * Write data from the given buffer to device.
+     * @param[in] buf buffer pointer.
+     * @param[in] count buffer size in bytes.
+     * @return number of bytes written or negative error code.
+     */
+    int write(const void* buf, size_t count)
+    {
+      iovec_t vec[2];
+      iovec_t* vp = vec;
+      iovec_arg(vp, buf, count);
+      iovec_end(vp);
+      transfer_start();
+      return (counted_write(bus().BUS::write(m_addr, vec)));
+    }
+
+    /**
+     * Write data to device with from given io vector.
+     * @param[in] vp io vector pointer.
+     * @return number of bytes written or negative error code.
+     */
+    int write(iovec_t* vp)
+    {
+      transfer_start();
+      return (counted_write(bus().BUS::write(m_addr, vp)));
+    }
+
+    /**
+     * Write data to device from given io vector and read response
+     * into given buffer (repeated start condition).
+     * @param[in] vp io vector pointer.
+     * @param[in] buf buffer pointer.
+     * @param[in] count buffer size in bytes.
+     * @return number of bytes read or negative error code.
+     */
+    int write_read(iovec_t* vp, void* buf, size_t count)
     {
+      transfer_start();
+      return (counted_write_read(vp, bus().BUS::write_read(m_addr, vp, buf, count)));
     }
 
     /**
-     * Start transaction. Return true(1) if successful otherwise
-     * false(0).
-     * @return bool.
+     * Write data to device from given source buffer and read
+     * response into given buffer (repeated start condition).
+     * @param[in] src source buffer pointer.
+     * @param[in] size source buffer size in bytes.
+     * @param[in] buf buffer pointer.
+     * @param[in] count buffer size in bytes.
+     * @return number of bytes read or negative error code.
      */
-    bool acquire()
+    int write_read(const void* src, size_t size, void* buf, size_t count)
     {
-      return (m_twi.acquire());
+      iovec_t vec[2];
+      iovec_t* vp = vec;
+      iovec_arg(vp, src, size);
+      iovec_end(vp);
+      transfer_start();
+      return (counted_write_read(vec, bus().BUS::write_read(m_addr, vec, buf, count)));
     }
 
     /**
-     * Stop transaction. Return true(1) if successful otherwise
-     * false(0).
-     * @return bool.
+     * Read register with given internal address into given buffer.
+     * The internal address is written most significant byte first
+     * followed by a repeated start condition and the read.
+     * @param[in] reg internal register address.
+     * @param[in] size internal address size in bytes (1..3).
+     * @param[in] buf buffer pointer.
+     * @param[in] count buffer size in bytes.
+     * @return number of bytes read or negative error code.
      */
-    bool release()
+    int read_register(uint32_t reg, uint8_t size, void* buf, size_t count)
     {
-      return (m_twi.release());
+      transfer_start();
+      return (counted_register(size, bus().BUS::read_register(m_addr, reg, size, buf, count)));
     }
 
     /**
-     * Read data from device to given buffer.
+     * Read register with given 8-bit internal address into given
+     * buffer.
+     * @param[in] reg internal register address.
      * @param[in] buf buffer pointer.
      * @param[in] count buffer size in bytes.
      * @return number of bytes read or negative error code.
      */
-    int read(void* buf, size_t count)
+    int read_register(uint8_t reg, void* buf, size_t count)
     {
-      return (m_twi.read(m_addr, buf, count));
+      return (read_register((uint32_t) reg, 1, buf, count));
     }
 
     /**
-     * Write data from the given buffer to device.
-     * @param[in] buf buffer pointer.
-     * @param[in] count buffer size in bytes.
-     * @return number of bytes written or negative error code.
+     * Perform transaction; write data from given io vector (if any)
+     * and read into given io vector buffers (if any). The
+     * transaction is retried according to the retry policy.
+     * @param[in] wp write io vector pointer or NULL.
+     * @param[in] rp read io vector pointer or NULL.
+     * @return number of bytes read (written when no read) or
+     * negative error code.
      */
-    int write(const void* buf, size_t count)
+    int transfer(iovec_t* wp, iovec_t* rp)
     {
-      return (m_twi.write(m_addr, buf, count));
+      return (Device::transfer(*this, wp, rp));
     }
 
     /**
-     * Write data to device with from given io vector.
-     * @param[in] vp io vector pointer.
-     * @return number of bytes written or negative error code.
+     * Wait for device to become ready; acknowledge polling. A device
+     * that is busy (e.g. measuring or writing) does not acknowledge
+     * its address. Issue an address only write (probe) with the given
+     * interval until acknowledged. Return true(1) if ready otherwise
+     * false(0) on timeout or error.
+     * @param[in] ms maximum wait time (milli-seconds).
+     * @param[in] us interval between probes (micro-seconds, default
+     * DEFAULT_POLL_INTERVAL).
+     * @return bool.
      */
-    int write(iovec_t* vp)
+    bool await_ready(uint16_t ms, uint16_t us = DEFAULT_POLL_INTERVAL)
     {
-      return (m_twi.write(m_addr, vp));
+      return (Device::await_ready(*this, ms, us));
     }
 
   protected:
-    /** Two-Wire Interface Manager. */
-    TWI& m_twi;
-
-    /** Device address. */
-    uint8_t m_addr;
+    /**
+     * Return bus manager with static type.
+     * @return bus manager reference.
+     */
+    BUS& bus()
+    {
+      return (static_cast<BUS&>(m_twi));
+    }
   };
 
   /** Default Two-Wire Interface clock: 100 KHz. */
   static const uint32_t DEFAULT_FREQ = 100000L;
 
+  /** Default transfer timeout: 25 ms (SMBus clock low timeout). */
+  static const uint16_t DEFAULT_TIMEOUT = 25;
+
+  /** Default acknowledge polling interval: 100 us. */
+  static const uint16_t DEFAULT_POLL_INTERVAL = 100;
+
   /**
    * Default constructor.
    */
   TWI() :
-    m_busy(false)
-  {}
+    m_busy(false),
+    m_owner(NULL),
+    m_depth(0),
+    m_timeout(DEFAULT_TIMEOUT),
+    m_acked(0),
+    m_error(E_BUS_ERROR),
+    m_arbitration_losses(0),
+    m_put(0),
+    m_get(0)
+  {
+    for (uint8_t level = 0; level < PRIORITY_MAX; level++) {
+      m_ticket[level] = 0;
+      m_serving[level] = 0;
+      m_bypass[level] = 0;
+      m_abandoned[level] = 0;
+    }
+  }
 
   /**
    * @override{TWI}
-   * Start bus transaction. Return true(1) if successful otherwise
-   * false(0).
+   * Start bus transaction. The caller should hold the bus manager
+   * lock; see TWI::Device::acquire(). Return true(1) if successful
+   * otherwise false(0).
    * @return bool.
    */
   virtual bool acquire() = 0;
@@ -130,6 +1133,40 @@ public:
    */
   virtual bool release() = 0;
 
+  /**
+   * @override{TWI}
+   * Recover bus after transfer timeout; a device may hold the data
+   * signal low waiting for clock pulses. Bus managers with access
+   * to the signals issue nine clock pulses and a stop condition.
+   * The default implementation does nothing. Return true(1) if the
+   * bus is free otherwise false(0).
+   * @return bool.
+   */
+  virtual bool recover()
+  {
+    return (true);
+  }
+
+  /**
+   * Get transfer timeout. A transfer that does not complete within
+   * the timeout is aborted with E_TIMEOUT and the bus is recovered.
+   * @return milli-seconds (zero for no timeout).
+   */
+  uint16_t timeout() const
+  {
+    return (m_timeout);
+  }
+
+  /**
+   * Set transfer timeout.
+   * @param[in] ms milli-seconds, zero(0) for no timeout (default
+   * DEFAULT_TIMEOUT).
+   */
+  void timeout(uint16_t ms)
+  {
+    m_timeout = ms;
+  }
+
   /**
    * @override{TWI}
    * Read data from device with given address into given buffer.
@@ -138,7 +1175,25 @@ public:
    * @param[in] count buffer size in bytes.
    * @return number of bytes read or negative error code.
    */
-  virtual int read(uint8_t addr, void* buf, size_t count) = 0;
+  virtual int read(uint8_t addr, void* buf, size_t count)
+  {
+    iovec_t vec[2];
+    iovec_t* vp = vec;
+    iovec_arg(vp, buf, count);
+    iovec_end(vp);
+    return (read(addr, vec));
+  }
+
+  /**
+   * @override{TWI}
+   * Read data from device with given address into given io vector
+   * buffers. The buffers are filled in order within a single read;
+   * only the last byte is not acknowledged.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes read or negative error code.
+   */
+  virtual int read(uint8_t addr, iovec_t* vp) = 0;
 
   /**
    * @override{TWI}
@@ -166,17 +1221,472 @@ public:
    */
   virtual int write(uint8_t addr, iovec_t* vp) = 0;
 
+  /**
+   * @override{TWI}
+   * Write data to device with given address from given io vector
+   * and read response into given buffer. The default implementation
+   * is a write followed by a read.
+   * @param[in] addr device address.
+   * @param[in] vp io vector pointer.
+   * @param[in] buf buffer pointer.
+   * @param[in] count buffer size in bytes.
+   * @return number of bytes read or negative error code.
+   */
+  virtual int write_read(uint8_t addr, iovec_t* vp, void* buf, size_t count)
+  {
+    int res = write(addr, vp);
+    if (res < 0) return (res);
+    return (read(addr, buf, count));
+  }
+
+  /**
+   * @override{TWI}
+   * Read register with given internal address from device with
+   * given address into given buffer. The default implementation
+   * writes the internal address, most significant byte first, with
+   * write_read().
+   * @param[in] addr device address.
+   * @param[in] reg internal register address.
+   * @param[in] size internal address size in bytes (1..3).
+   * @param[in] buf buffer pointer.
+   * @param[in] count buffer size in bytes.
+   * @return number of bytes read or negative error code.
+   */
+  virtual int read_register(uint8_t addr, uint32_t reg, uint8_t size,
+			    void* buf, size_t count)
+  {
+    uint8_t adr[3];
+    if (size == 0 || size > sizeof(adr)) return (E_BUS_ERROR);
+    for (uint8_t i = size; i != 0; i--) {
+      adr[i - 1] = reg;
+      reg >>= 8;
+    }
+    iovec_t vec[2];
+    iovec_t* vp = vec;
+    iovec_arg(vp, adr, size);
+    iovec_end(vp);
+    return (write_read(addr, vec, buf, count));
+  }
+
+  /**
+   * Return error code of the last failed release; stop condition or
+   * deferred writes (E_BUS_ERROR if not reported by the bus
+   * manager).
+   * @return negative error code.
+   */
+  int last_error() const
+  {
+    return (m_error);
+  }
+
+  /**
+   * Return number of data bytes acknowledged by the device in the
+   * last write that failed with E_DATA_NACK.
+   * @return number of bytes.
+   */
+  size_t acknowledged() const
+  {
+    return (m_acked);
+  }
+
+  /**
+   * Return number of arbitration losses on the bus; another master
+   * won the bus during an address or data phase (multi-master).
+   * @return number of arbitration losses.
+   */
+  uint16_t arbitration_losses() const
+  {
+    return (m_arbitration_losses);
+  }
+
+  /**
+   * Reset number of arbitration losses.
+   */
+  void reset_arbitration_losses()
+  {
+    m_arbitration_losses = 0;
+  }
+
+#if defined(TWI_HISTOGRAM)
+  /**
+   * Return histogram of device bus hold times; acquire() to
+   * release().
+   * @return histogram reference.
+   */
+  Histogram& hold_histogram()
+  {
+    return (m_hold_histogram);
+  }
+
+  /**
+   * Return histogram of device transfer times; read(), write() and
+   * write_read().
+   * @return histogram reference.
+   */
+  Histogram& transfer_histogram()
+  {
+    return (m_transfer_histogram);
+  }
+#endif
+
+  /**
+   * Wait for given transaction to complete. The transaction is
+   * checked against the transfer timeout while waiting; see
+   * watchdog(). Return number of bytes transferred or negative error
+   * code.
+   * @param[in] tp transaction pointer.
+   * @return number of bytes or negative error code.
+   */
+  int await(transaction_t* tp)
+  {
+    while (!tp->completed) {
+      watchdog();
+      yield();
+    }
+    return (tp->result);
+  }
+
+  /**
+   * @override{TWI}
+   * Check the current asynchronous transaction against the transfer
+   * timeout. An expired transaction is aborted, the bus is recovered
+   * and the transaction is completed with E_TIMEOUT. Called by
+   * await(); a sketch that only uses the transaction callback should
+   * call it periodically. The default implementation does nothing.
+   */
+  virtual void watchdog()
+  {
+  }
+
+  /**
+   * Submit given transaction to the queue and dispatch. Return
+   * true(1) if successful otherwise false(0) if the queue is full.
+   * @param[in] tp transaction pointer.
+   * @return bool.
+   */
+  bool submit(transaction_t* tp)
+  {
+    uint8_t put = (m_put + 1) & QUEUE_MASK;
+    if (put == m_get) return (false);
+    tp->result = 0;
+    tp->completed = false;
+    m_queue[m_put] = tp;
+    m_put = put;
+    dispatch();
+    return (true);
+  }
+
+  /**
+   * @override{TWI}
+   * Dispatch queued transactions. The default implementation
+   * performs the transactions back-to-back in the caller context.
+   * The queue is left as is when the bus is locked, e.g. submit()
+   * within a transaction; the transactions are dispatched when the
+   * device driver releases the bus. Asynchronous bus managers should
+   * start the queue and continue in the background.
+   */
+  virtual void dispatch()
+  {
+    while (1) {
+      uint8_t key = disable();
+      bool locked = (m_put != m_get) && try_lock();
+      restore(key);
+      if (!locked) return;
+      transaction_t* tp = dequeue();
+      int res = E_BUS_ERROR;
+      if (acquire()) {
+	if ((tp->vp != NULL) || (tp->count == 0))
+	  res = write(tp->addr, tp->vp);
+	if ((res >= 0) && (tp->count != 0))
+	  res = read(tp->addr, tp->buf, tp->count);
+	release();
+      }
+      unlock();
+      notify(tp, res);
+    }
+  }
+
 protected:
+  /** Transaction queue size (power of 2). */
+  static const uint8_t QUEUE_MAX = 8;
+
+  /** Transaction queue index mask. */
+  static const uint8_t QUEUE_MASK = QUEUE_MAX - 1;
+
+  /** Maximum number of grants to higher priority levels while waiting. */
+  static const uint8_t BYPASS_MAX = 4;
+
+  /** Maximum number of retries after arbitration loss. */
+  static const uint8_t ARBITRATION_RETRY_MAX = 4;
+
   /** Bus manager semaphore. */
   volatile bool m_busy;
 
+  /** Device driver that acquired the bus (nested transactions). */
+  Device* m_owner;
+
+  /** Transaction nesting depth. */
+  uint8_t m_depth;
+
+  /** Next lock ticket per priority level. */
+  volatile uint8_t m_ticket[PRIORITY_MAX];
+
+  /** Lock ticket served per priority level. */
+  volatile uint8_t m_serving[PRIORITY_MAX];
+
+  /** Number of grants that bypassed waiting requests per level. */
+  uint8_t m_bypass[PRIORITY_MAX];
+
+  /** Tickets abandoned on lock timeout per level; bit (ticket & 7). */
+  volatile uint8_t m_abandoned[PRIORITY_MAX];
+
+  /** Transfer timeout (ms). */
+  uint16_t m_timeout;
+
+  /** Number of data bytes acknowledged before data not acknowledged. */
+  size_t m_acked;
+
+  /** Error code of last failed release. */
+  int m_error;
+
+  /** Number of arbitration losses. */
+  volatile uint16_t m_arbitration_losses;
+
+#if defined(TWI_HISTOGRAM)
+  /** Histogram of device bus hold times. */
+  Histogram m_hold_histogram;
+
+  /** Histogram of device transfer times. */
+  Histogram m_transfer_histogram;
+#endif
+
+  /** Transaction queue; single producer and consumer ring buffer. */
+  transaction_t* m_queue[QUEUE_MAX];
+
+  /** Transaction queue put index (producer). */
+  volatile uint8_t m_put;
+
+  /** Transaction queue get index (consumer). */
+  volatile uint8_t m_get;
+
+  /**
+   * Return next transaction from the queue or NULL if empty.
+   * @return transaction pointer or NULL.
+   */
+  transaction_t* dequeue()
+  {
+    uint8_t get = m_get;
+    if (get == m_put) return (NULL);
+    transaction_t* tp = m_queue[get];
+    m_get = (get + 1) & QUEUE_MASK;
+    return (tp);
+  }
+
+  /**
+   * Mark given transaction as completed with given result and call
+   * the transaction callback.
+   * @param[in] tp transaction pointer.
+   * @param[in] res number of bytes or negative error code.
+   */
+  static void notify(transaction_t* tp, int res)
+  {
+    tp->result = res;
+    tp->completed = true;
+    if (tp->callback != NULL) tp->callback(tp);
+  }
+
+  /**
+   * Return true(1) if there are lock requests waiting on given
+   * priority level otherwise false(0).
+   * @param[in] level priority level.
+   * @return bool.
+   */
+  bool is_waiting(uint8_t level) const
+  {
+    return (m_ticket[level] != m_serving[level]);
+  }
+
+  /**
+   * Return true(1) if the lock may be granted to the given ticket
+   * on the given priority level otherwise false(0). Higher levels
+   * are served first. A level that has been bypassed BYPASS_MAX
+   * times is served before higher levels; this bounds the wait.
+   * @param[in] level priority level.
+   * @param[in] ticket lock ticket.
+   * @return bool.
+   */
+  bool is_granted(uint8_t level, uint8_t ticket) const
+  {
+    if (m_busy || m_serving[level] != ticket) return (false);
+    for (uint8_t lower = level + 1; lower < PRIORITY_MAX; lower++)
+      if (is_waiting(lower) && m_bypass[lower] >= BYPASS_MAX) return (false);
+    if (m_bypass[level] >= BYPASS_MAX) return (true);
+    for (uint8_t higher = 0; higher < level; higher++)
+      if (is_waiting(higher)) return (false);
+    return (true);
+  }
+
+  /**
+   * Arbitration lost; another master won the bus. Count the loss
+   * and return true(1) if the operation should be retried otherwise
+   * false(0). The bus manager should wait for the bus to be free
+   * and retry with a start condition.
+   * @param[in] retry number of retries so far.
+   * @return bool.
+   */
+  bool arbitration_lost(uint8_t retry)
+  {
+    m_arbitration_losses += 1;
+    return (retry < ARBITRATION_RETRY_MAX);
+  }
+
+  /**
+   * Disable interrupts. Return key to restore the interrupt state.
+   * Other architectures enable interrupts on restore().
+   * @return key.
+   */
+  static uint8_t disable()
+  {
+#if defined(SAM)
+    uint8_t key = __get_PRIMASK();
+    __disable_irq();
+#elif defined(AVR)
+    uint8_t key = SREG;
+    cli();
+#else
+    uint8_t key = 0;
+    noInterrupts();
+#endif
+    return (key);
+  }
+
+  /**
+   * Restore interrupt state with given key.
+   * @param[in] key from disable().
+   */
+  static void restore(uint8_t key)
+  {
+#if defined(SAM)
+    __set_PRIMASK(key);
+#elif defined(AVR)
+    SREG = key;
+#else
+    (void) key;
+    interrupts();
+#endif
+  }
+
+  /**
+   * Return total size of given io vector buffers in bytes.
+   * @param[in] vp io vector pointer.
+   * @return number of bytes.
+   */
+  static size_t iovec_size(const iovec_t* vp)
+  {
+    size_t size = 0;
+    if (vp == NULL) return (0);
+    for (; vp->buf != NULL; vp++) size += vp->size;
+    return (size);
+  }
+
+  /**
+   * Skip abandoned tickets that are next to be served. Should be
+   * called with interrupts disabled.
+   */
+  void skip_abandoned()
+  {
+    for (uint8_t level = 0; level < PRIORITY_MAX; level++) {
+      uint8_t mask;
+      while (m_abandoned[level] & (mask = (1 << (m_serving[level] & 7)))) {
+	m_abandoned[level] &= ~mask;
+	m_serving[level] += 1;
+      }
+    }
+  }
+
+  /**
+   * Lock bus manager. Wait for a ticket on the given priority
+   * level to be granted.
+   * @param[in] level priority level (default NORMAL_PRIORITY).
+   */
+  void lock(uint8_t level = NORMAL_PRIORITY)
+  {
+    uint8_t key = disable();
+    uint8_t ticket = m_ticket[level]++;
+    skip_abandoned();
+    while (!is_granted(level, ticket)) {
+      restore(key);
+      yield();
+      disable();
+      skip_abandoned();
+    }
+    granted(level);
+    restore(key);
+  }
+
+  /**
+   * Lock bus manager. Wait at most the given time for a ticket on
+   * the given priority level to be granted. The ticket is abandoned
+   * on timeout; at most eight tickets per level may be outstanding.
+   * Return true(1) if successful otherwise false(0).
+   * @param[in] level priority level.
+   * @param[in] ms maximum wait time (milli-seconds).
+   * @return bool.
+   */
+  bool lock(uint8_t level, uint16_t ms)
+  {
+    uint32_t start = millis();
+    uint8_t key = disable();
+    uint8_t ticket = m_ticket[level]++;
+    skip_abandoned();
+    while (!is_granted(level, ticket)) {
+      if (millis() - start >= ms) {
+	if ((uint8_t) (ticket + 1) == m_ticket[level])
+	  m_ticket[level] = ticket;
+	else
+	  m_abandoned[level] |= (1 << (ticket & 7));
+	skip_abandoned();
+	restore(key);
+	return (false);
+      }
+      restore(key);
+      yield();
+      disable();
+      skip_abandoned();
+    }
+    granted(level);
+    restore(key);
+    return (true);
+  }
+
+  /**
+   * Mark lock as granted to the next ticket on the given priority
+   * level. Should be called with interrupts disabled.
+   * @param[in] level priority level.
+   */
+  void granted(uint8_t level)
+  {
+    m_busy = true;
+    m_serving[level] += 1;
+    m_bypass[level] = 0;
+    for (uint8_t lower = level + 1; lower < PRIORITY_MAX; lower++)
+      if (is_waiting(lower)) m_bypass[lower] += 1;
+  }
+
   /**
-   * Lock bus manager.
+   * Lock bus manager if idle and there are no waiting requests.
+   * Should be called with interrupts disabled. Return true(1) if
+   * successful otherwise false(0).
+   * @return bool.
    */
-  void lock()
+  bool try_lock()
   {
-    while (m_busy) yield();
+    if (m_busy) return (false);
+    skip_abandoned();
+    for (uint8_t level = 0; level < PRIORITY_MAX; level++)
+      if (is_waiting(level)) return (false);
     m_busy = true;
+    return (true);
   }
 
   /**
@@ -187,4 +1697,22 @@ protected:
     m_busy = false;
   }
 };
+
+/**
+ * Device Driver for the abstract bus manager; virtual dispatch.
+ */
+template<>
+class TWI::Driver<TWI> : public TWI::Device {
+public:
+  /**
+   * Construct Two-Wire Interface Device Driver with given bus and
+   * device address.
+   * @param[in] twi bus manager.
+   * @param[in] addr device address.
+   */
+  Driver(TWI& twi, uint8_t addr) :
+    Device(twi, addr)
+  {
+  }
+};
 #endif
@@ -0,0 +1,220 @@
+/**
+ * @file test/arbitration.cpp
+ *
+ * Software::TWI arbitration on a simulated multi-master bus. Two
+ * masters on the same signals, and a master losing to another master
+ * after a repeated start condition.
+ */
+
+#include "Arduino.h"
+#include "TWI.h"
+#include "Software/TWI.h"
+#include <assert.h>
+
+// Signals; data (line 0) and clock (line 1) pulled low by master A
+// (D18/D19), master B (D8/D9), the device or another master (data)
+bool a_low[2], b_low[2], device_low[2], other_low;
+bool latched[2] = { true, true };
+
+bool level(int line)
+{
+  return (!(a_low[line] || b_low[line] || device_low[line]
+	    || (line == 0 && other_low)));
+}
+
+// Device with register pointer at address 0x40. The first byte
+// written sets the pointer, further bytes are written to the
+// registers, and reads return the registers from the pointer.
+struct Device {
+  uint8_t reg[256];
+  uint8_t ptr;
+  uint8_t data;
+  int bit;
+  enum { IDLE, RECEIVE, TRANSMIT } state;
+  bool addressed;
+  bool ack;
+  bool pointer;
+  bool sda;
+  bool scl;
+  int starts;
+  int stops;
+
+  void step()
+  {
+    bool sda_now = level(0), scl_now = level(1);
+    if (scl && scl_now && sda && !sda_now) {
+      // Start condition
+      state = RECEIVE;
+      bit = 0;
+      data = 0;
+      addressed = false;
+      ack = false;
+      pointer = true;
+      device_low[0] = false;
+      starts += 1;
+    }
+    else if (scl && scl_now && !sda && sda_now) {
+      // Stop condition
+      state = IDLE;
+      device_low[0] = false;
+      stops += 1;
+    }
+    else if (!scl && scl_now) {
+      // Clock high; sample data or acknowledge
+      if (ack) {
+	if (state == TRANSMIT && sda_now) state = IDLE;
+      }
+      else if (state == RECEIVE) {
+	data = (data << 1) | sda_now;
+	bit += 1;
+      }
+      else if (state == TRANSMIT) {
+	bit += 1;
+      }
+    }
+    else if (scl && !scl_now) {
+      // Clock low; drive data or acknowledge
+      if (ack) {
+	ack = false;
+	device_low[0] = false;
+	if (state == TRANSMIT) {
+	  data = reg[ptr++];
+	  bit = 0;
+	  device_low[0] = !(data & 0x80);
+	}
+      }
+      else if (state == RECEIVE && bit == 8) {
+	if (!addressed) {
+	  addressed = true;
+	  device_low[0] = ((data >> 1) == 0x40);
+	  if (!device_low[0]) state = IDLE;
+	  else if (data & 1) state = TRANSMIT;
+	}
+	else {
+	  if (pointer) ptr = data; else reg[ptr++] = data;
+	  pointer = false;
+	  device_low[0] = true;
+	}
+	ack = true;
+	bit = 0;
+	data = 0;
+      }
+      else if (state == TRANSMIT) {
+	if (bit == 8) {
+	  device_low[0] = false;
+	  ack = true;
+	}
+	else {
+	  device_low[0] = !((data << bit) & 0x80);
+	}
+      }
+    }
+    sda = sda_now;
+    scl = scl_now;
+  }
+} device;
+
+bool* driver(BOARD::pin_t pin)
+{
+  return ((pin == BOARD::D8 || pin == BOARD::D9) ? b_low : a_low);
+}
+
+// Masters clocked together; pins read the levels of the previous tick
+bool lockstep(BOARD::pin_t pin, uint8_t op)
+{
+  if (op == GPIO_READ) return (latched[pin & 1]);
+  driver(pin)[pin & 1] = (op == GPIO_OUTPUT);
+  return (true);
+}
+
+// Another master pulls data low after the next repeated start
+// condition, wins arbitration, moves the register pointer and issues
+// a stop condition when master A has seen the data signal low
+bool lose = false;
+bool sampled = false;
+int losses = 0;
+
+bool blocking(BOARD::pin_t pin, uint8_t op)
+{
+  int line = pin & 1;
+  if (op != GPIO_READ) driver(pin)[line] = (op == GPIO_OUTPUT);
+  if (other_low && sampled && !a_low[0] && !a_low[1]) {
+    other_low = false;
+    sampled = false;
+    device.ptr = 0x77;
+  }
+  int starts = device.starts, stops = device.stops;
+  bool busy = (device.state != Device::IDLE) || (starts != stops);
+  device.step();
+  if (lose && busy && device.starts != starts) {
+    lose = false;
+    other_low = true;
+    losses += 1;
+  }
+  bool value = level(line);
+  if (op == GPIO_READ && line == 0 && other_low && level(1)) sampled = true;
+  return (value);
+}
+
+Software::TWI<BOARD::D18, BOARD::D19, 0> a;
+Software::TWI<BOARD::D8, BOARD::D9, 0> b;
+
+int main()
+{
+  for (int i = 0; i < 256; i++) device.reg[i] = i;
+  device.sda = device.scl = true;
+
+  // Both masters write; B wins on the data byte, A retries when free
+  gpio_model = lockstep;
+  uint8_t da[2] = { 0x55, 0x11 }, db[2] = { 0x50, 0x22 };
+  iovec_t va[2], vb[2];
+  iovec_t* vp = va;
+  iovec_arg(vp, da, sizeof(da));
+  iovec_end(vp);
+  vp = vb;
+  iovec_arg(vp, db, sizeof(db));
+  iovec_end(vp);
+  TWI::transaction_t ta = { 0x40 << 1, va, NULL, 0, NULL, NULL, 0, false };
+  TWI::transaction_t tb = { 0x40 << 1, vb, NULL, 0, NULL, NULL, 0, false };
+  assert(a.start(&ta) && b.start(&tb));
+  for (int i = 0; (!ta.completed || !tb.completed) && i < 100000; i++) {
+    a.tick();
+    b.tick();
+    device.step();
+    latched[0] = level(0);
+    latched[1] = level(1);
+  }
+  assert(ta.result == 2 && tb.result == 2);
+  assert(a.arbitration_losses() == 1 && b.arbitration_losses() == 0);
+  assert(device.reg[0x50] == 0x22 && device.reg[0x55] == 0x11);
+  assert(device.starts == 2 && device.stops == 2);
+
+  // Lost after the repeated start of the read; no stop condition on
+  // release as the bus is used by the other master
+  gpio_model = blocking;
+  device.reg[0x50] = 0x50;
+  device.reg[0x55] = 0x55;
+  TWI::Device dev(a, 0x40);
+  uint8_t reg = 0x10, buf[2];
+  lose = true;
+  assert(dev.acquire());
+  assert(dev.read_register(reg, buf, sizeof(buf)) == TWI::E_ARB_LOST);
+  int stops = device.stops;
+  dev.release();
+  assert(device.stops == stops && losses == 1);
+
+  // Transfer retries the whole transaction; register pointer written
+  lose = true;
+  dev.retry(TWI::Retry(3));
+  iovec_t wv[2], rv[2];
+  vp = wv;
+  iovec_arg(vp, &reg, sizeof(reg));
+  iovec_end(vp);
+  vp = rv;
+  iovec_arg(vp, buf, sizeof(buf));
+  iovec_end(vp);
+  assert(dev.transfer(wv, rv) == 2);
+  assert(buf[0] == 0x10 && buf[1] == 0x11 && losses == 2);
+  assert(a.arbitration_losses() == 3);
+  return (0);
+}
@@ -0,0 +1,148 @@
+/**
+ * @file test/avr.cpp
+ *
+ * Hardware::TWI (AVR) against the register model; blocking and
+ * interrupt driven transactions, and arbitration loss.
+ */
+
+#define AVR
+#include "Arduino.h"
+#include "TWI.h"
+#include "Hardware/AVR/TWI.h"
+#include "avr_model.h"
+#include <assert.h>
+
+Hardware::TWI twi;
+int callbacks = 0;
+
+void completed(TWI::transaction_t* tp)
+{
+  (void) tp;
+  callbacks += 1;
+}
+
+// Call the interrupt service routine until the transaction completes
+void run(TWI::transaction_t& t)
+{
+  for (int i = 0; !t.completed && i < 1000; i++)
+    if (TWCR & _BV(TWINT)) twi.isr();
+}
+
+int main()
+{
+  avr_model_begin(0x40 << 1);
+  TWI::Device dev(twi, 0x40);
+  uint8_t buf[4];
+
+  // Blocking register write and read
+  uint8_t data[3] = { 0x20, 0xa5, 0x5a };
+  assert(dev.acquire());
+  assert(dev.write(data, sizeof(data)) == 3);
+  assert(dev.read_register((uint8_t) 0x20, buf, 2) == 2);
+  assert(dev.release());
+  assert(buf[0] == 0xa5 && buf[1] == 0x5a);
+  assert(model.starts == 3 && model.stops == 1);
+
+  // Interrupt driven write, repeated start and read
+  uint8_t reg = 0x10;
+  iovec_t vec[2];
+  iovec_t* vp = vec;
+  iovec_arg(vp, &reg, sizeof(reg));
+  iovec_end(vp);
+  TWI::transaction_t t = { 0x40 << 1, vec, buf, 3, completed, NULL, 0, false };
+  model.starts = model.stops = 0;
+  assert(twi.start(&t));
+  run(t);
+  assert(t.completed && t.result == 3 && callbacks == 1);
+  assert(buf[0] == 0x10 && buf[1] == 0x11 && buf[2] == 0x12);
+  assert(model.starts == 2 && model.stops == 1);
+
+  // Write only transaction
+  TWI::transaction_t w = { 0x40 << 1, vec, NULL, 0, completed, NULL, 0, false };
+  assert(twi.start(&w));
+  run(w);
+  assert(w.completed && w.result == 1 && callbacks == 2);
+
+  // Device not present; address not acknowledged
+  TWI::transaction_t p = { 0x41 << 1, NULL, NULL, 0, completed, NULL, 0, false };
+  assert(twi.start(&p));
+  run(p);
+  assert(p.completed && p.result == TWI::E_ADDR_NACK && callbacks == 3);
+
+  // Bus lock released on completion
+  assert(dev.acquire());
+  assert(dev.read(buf, 1) == 1);
+  assert(dev.release());
+
+  // Release by a device that does not own the bus leaves the bus and
+  // the lock as is
+  TWI::Device other(twi, 0x41);
+  assert(dev.acquire());
+  model.stops = 0;
+  assert(!other.release());
+  assert(model.stops == 0);
+  assert(!other.acquire(1));
+  assert(dev.release());
+  assert(model.stops == 1);
+  assert(!other.release());
+
+  // Interrupt state is restored by the bus manager lock and queue
+  SREG = 0;
+  assert(dev.acquire() && dev.release());
+  assert(SREG == 0);
+  SREG = _BV(SREG_I);
+  assert(dev.acquire() && dev.release());
+  assert(SREG == _BV(SREG_I));
+
+  // Arbitration lost on the read after the repeated start; the read
+  // is not repeated with the register pointer moved
+  uint8_t losses = twi.arbitration_losses();
+  model.addresses = 0;
+  model.arbitration = 2;
+  assert(dev.acquire());
+  assert(dev.read_register(reg, buf, 2) == TWI::E_ARB_LOST);
+  dev.release();
+
+  // Transfer retries the whole transaction; register pointer written
+  iovec_t rv[2];
+  vp = rv;
+  iovec_arg(vp, buf, 2);
+  iovec_end(vp);
+  model.addresses = 0;
+  model.arbitration = 2;
+  dev.retry(TWI::Retry(3));
+  assert(dev.transfer(vec, rv) == 2);
+  assert(buf[0] == 0x10 && buf[1] == 0x11);
+
+  // First phase is retried by the bus manager
+  model.addresses = 0;
+  model.arbitration = 1;
+  assert(dev.acquire());
+  assert(dev.read(buf, 1) == 1);
+  assert(dev.release());
+  assert(buf[0] == 0x77);
+
+  // Interrupt driven; the transaction is restarted when the bus is free
+  model.addresses = 0;
+  model.arbitration = 2;
+  model.starts = model.stops = 0;
+  TWI::transaction_t r = { 0x40 << 1, vec, buf, 2, completed, NULL, 0, false };
+  assert(twi.start(&r));
+  run(r);
+  assert(r.completed && r.result == 2);
+  assert(buf[0] == 0x10 && buf[1] == 0x11);
+  assert(model.starts == 4 && model.stops == 1);
+  assert(twi.arbitration_losses() == losses + 4);
+
+  // Interrupt driven; the watchdog completes a transaction that does
+  // not make progress within the timeout and recovers the bus
+  int cb = callbacks;
+  twi.timeout(1);
+  TWI::transaction_t s = { 0x40 << 1, vec, buf, 2, completed, NULL, 0, false };
+  assert(twi.start(&s));
+  assert(twi.await(&s) == TWI::E_TIMEOUT && callbacks == cb + 1);
+  twi.timeout(TWI::DEFAULT_TIMEOUT);
+  assert(dev.acquire());
+  assert(dev.release());
+  return (0);
+}
@@ -0,0 +1,96 @@
+/**
+ * @file test/avr_model.h
+ *
+ * AVR TWI register model; a device with a register pointer. The
+ * first byte written sets the pointer, further bytes are written to
+ * the registers, and reads return the registers from the pointer.
+ * Commands complete directly; the interrupt flag is set. Arbitration
+ * may be lost to another master on a given address byte; the other
+ * master moves the register pointer.
+ */
+
+#ifndef TEST_AVR_MODEL_H
+#define TEST_AVR_MODEL_H
+
+struct avr_model_t {
+  uint8_t addr;			//!< Device address.
+  uint8_t reg[256];		//!< Device registers.
+  uint8_t ptr;			//!< Register pointer.
+  bool started;			//!< Bus owned; start condition issued.
+  bool addressed;		//!< Address byte transferred.
+  bool reading;			//!< Read request.
+  bool pointer;			//!< Next write sets the register pointer.
+  int starts;			//!< Number of start conditions.
+  int stops;			//!< Number of stop conditions.
+  int addresses;		//!< Number of address bytes.
+  int arbitration;		//!< Address byte to lose; zero for none.
+};
+
+static avr_model_t model;
+
+/**
+ * Perform the command given by the control register value.
+ * @param[in] cr control register value.
+ */
+static void avr_model(uint8_t cr)
+{
+  // Hardware disabled; bus recovery ends the transfer with a stop
+  if (!(cr & _BV(TWEN))) model.started = false;
+  if (!(cr & _BV(TWINT))) return;
+  if (cr & _BV(TWSTO)) {
+    if (model.started) model.stops += 1;
+    model.started = false;
+    TWCR.value = cr & ~(_BV(TWSTO) | _BV(TWINT));
+    return;
+  }
+  if (cr & _BV(TWSTA)) {
+    TWSR = model.started ? 0x10 : 0x08;
+    model.started = true;
+    model.addressed = false;
+    model.starts += 1;
+  }
+  else if (!model.started) {
+    TWCR.value = cr & ~_BV(TWINT);
+    return;
+  }
+  else if (!model.addressed) {
+    model.addressed = true;
+    model.reading = (TWDR & 1);
+    model.pointer = true;
+    if (++model.addresses == model.arbitration) {
+      model.started = false;
+      model.ptr = 0x77;
+      TWSR = 0x38;
+      TWCR.value = cr | _BV(TWINT);
+      return;
+    }
+    bool ack = ((TWDR & 0xfe) == model.addr);
+    if (model.reading)
+      TWSR = ack ? 0x40 : 0x48;
+    else
+      TWSR = ack ? 0x18 : 0x20;
+  }
+  else if (model.reading) {
+    TWDR = model.reg[model.ptr++];
+    TWSR = (cr & _BV(TWEA)) ? 0x50 : 0x58;
+  }
+  else {
+    if (model.pointer) model.ptr = TWDR; else model.reg[model.ptr++] = TWDR;
+    model.pointer = false;
+    TWSR = 0x28;
+  }
+  TWCR.value = cr | _BV(TWINT);
+}
+
+/**
+ * Initiate register model with given device address (8-bit).
+ * @param[in] addr device address.
+ */
+static void avr_model_begin(uint8_t addr)
+{
+  memset(&model, 0, sizeof(model));
+  model.addr = addr;
+  for (int i = 0; i < 256; i++) model.reg[i] = i;
+  twi_model = avr_model;
+}
+#endif
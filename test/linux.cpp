@@ -0,0 +1,117 @@
+/**
+ * @file test/linux.cpp
+ *
+ * Linux::TWI against an i2c-dev adapter model; deferred writes and
+ * combined transfers, adapter fault codes and arbitration retry.
+ */
+
+#include "Arduino.h"
+#include "TWI.h"
+#include "Linux/TWI.h"
+#include <stdarg.h>
+#include <assert.h>
+
+// Adapter model; records the last combined transfer and fails the
+// given number of calls with the given fault code
+const int FD = 42;
+struct i2c_msg msgs[4];
+uint8_t data[4][8];
+unsigned nmsgs;
+int calls;
+int failures;
+int fault;
+
+extern "C" int ioctl(int fd, unsigned long request, ...) throw()
+{
+  va_list args;
+  va_start(args, request);
+  struct i2c_rdwr_ioctl_data* dp = va_arg(args, struct i2c_rdwr_ioctl_data*);
+  va_end(args);
+  assert(fd == FD && request == I2C_RDWR);
+  calls += 1;
+  if (failures != 0) {
+    failures -= 1;
+    errno = fault;
+    return (-1);
+  }
+  nmsgs = dp->nmsgs;
+  for (unsigned i = 0; i < nmsgs; i++) {
+    msgs[i] = dp->msgs[i];
+    if (dp->msgs[i].flags & I2C_M_RD)
+      for (unsigned j = 0; j < dp->msgs[i].len; j++) dp->msgs[i].buf[j] = 0xa0 + j;
+    else
+      memcpy(data[i], dp->msgs[i].buf, dp->msgs[i].len);
+  }
+  return (nmsgs);
+}
+
+int main()
+{
+  Linux::TWI twi(FD);
+  TWI::Device dev(twi, 0x50);
+  uint8_t reg[2] = { 0x01, 0x02 };
+  uint8_t val = 0x03;
+  uint8_t buf[2];
+  uint8_t page[4];
+
+  // Deferred writes and the read are issued as a single transfer
+  assert(dev.acquire());
+  assert(dev.write(reg, sizeof(reg)) == 2);
+  assert(dev.write(&val, sizeof(val)) == 1);
+  assert(calls == 0);
+  assert(dev.read(buf, sizeof(buf)) == 2);
+  assert(calls == 1 && nmsgs == 3);
+  assert(msgs[0].addr == 0x50 && msgs[0].flags == 0 && msgs[0].len == 2);
+  assert(data[0][0] == 0x01 && data[0][1] == 0x02);
+  assert(msgs[1].flags == 0 && msgs[1].len == 1 && data[1][0] == 0x03);
+  assert(msgs[2].flags == I2C_M_RD && msgs[2].len == 2);
+  assert(buf[0] == 0xa0 && buf[1] == 0xa1);
+  assert(dev.release());
+  assert(calls == 1);
+
+  // Read into several buffers through the deferred write buffer
+  iovec_t vec[3];
+  iovec_t* vp = vec;
+  iovec_arg(vp, buf, sizeof(buf));
+  iovec_arg(vp, page, sizeof(page));
+  iovec_end(vp);
+  assert(dev.acquire());
+  assert(dev.read(vec) == 6);
+  assert(dev.release());
+  assert(buf[0] == 0xa0 && buf[1] == 0xa1);
+  assert(page[0] == 0xa2 && page[3] == 0xa5);
+
+  // Deferred write not acknowledged; error code returned by release
+  calls = 0;
+  failures = 1;
+  fault = ENXIO;
+  assert(dev.acquire());
+  assert(dev.write(reg, sizeof(reg)) == 2);
+  assert(!dev.release());
+  assert(twi.last_error() == TWI::E_ADDR_NACK);
+  failures = 1;
+  fault = EREMOTEIO;
+  assert(dev.write_read(reg, sizeof(reg), buf, sizeof(buf)) == TWI::E_DATA_NACK);
+  assert(calls == 2);
+
+  // Arbitration lost (EAGAIN); transfer retried and losses counted
+  calls = 0;
+  failures = 2;
+  fault = EAGAIN;
+  twi.reset_arbitration_losses();
+  assert(dev.write_read(reg, sizeof(reg), buf, sizeof(buf)) == 2);
+  assert(calls == 3 && twi.arbitration_losses() == 2);
+
+  // Retries exhausted; first attempt and four retries lost
+  failures = 5;
+  assert(dev.write_read(reg, sizeof(reg), buf, sizeof(buf)) == TWI::E_ARB_LOST);
+  assert(failures == 0);
+
+  // Address only write (probe) issued directly
+  calls = 0;
+  assert(dev.acquire());
+  assert(dev.write(NULL) == 0);
+  assert(calls == 1 && nmsgs == 1 && msgs[0].len == 0);
+  assert(dev.release());
+  return (0);
+}
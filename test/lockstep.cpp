@@ -0,0 +1,133 @@
+/**
+ * @file test/lockstep.cpp
+ *
+ * Software::LockstepTWI against devices on three lanes; per-lane
+ * acknowledge masks, read data per lane and clock stretching
+ * timeout.
+ */
+
+#define AVR
+#include "Arduino.h"
+#include "TWI.h"
+#include "Software/LockstepTWI.h"
+#include <sys/mman.h>
+#include <assert.h>
+
+// Data signal port registers; PIN, DDR and PORT
+volatile uint8_t* const port = (volatile uint8_t*) 0x100000;
+
+const uint8_t LANES = 3;
+const uint8_t ALL = (1 << LANES) - 1;
+
+// Devices on the lanes; acknowledge mask per byte, data bytes per
+// lane for read. Clock falling edges are counted from the start
+// condition. The data signals read high unless pulled low by the
+// master (data direction) or a device
+uint8_t acks[3];
+uint8_t data[LANES][2];
+bool reading;
+bool stretching;
+bool scl_low;
+uint8_t device_low;
+int bits;
+
+void update()
+{
+  port[0] = ~(port[1] | device_low) & ALL;
+}
+
+bool device(BOARD::pin_t pin, uint8_t op)
+{
+  assert(pin == BOARD::D19);
+  if (op == GPIO_READ) {
+    update();
+    return (!scl_low && !stretching);
+  }
+  bool low = (op == GPIO_OUTPUT);
+  if (low && !scl_low) {
+    bits += 1;
+    int byte = bits / 9;
+    int bit = bits % 9;
+    device_low = 0;
+    if (bit == 8) {
+      if (!reading || byte == 0) device_low = acks[byte];
+    }
+    else if (reading && byte > 0) {
+      for (uint8_t lane = 0; lane < LANES; lane++)
+	if (!(data[lane][byte - 1] & (0x80 >> bit))) device_low |= (1 << lane);
+    }
+  }
+  scl_low = low;
+  update();
+  return (true);
+}
+
+// Prepare devices for a transaction; bus idle
+void transaction(bool read)
+{
+  reading = read;
+  bits = -1;
+  device_low = 0;
+  update();
+}
+
+int main()
+{
+  void* regs = mmap((void*) port, 4096, PROT_READ | PROT_WRITE,
+		    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  assert(regs == (void*) port);
+  gpio_model = device;
+  Software::LockstepTWI<BOARD::P0, BOARD::D19, LANES, 0> twi;
+  uint8_t cmd[2] = { 0x10, 0x20 };
+  uint8_t buf[LANES * 2];
+
+  // Address not acknowledged on lane 1; data not acknowledged on
+  // lane 2
+  acks[0] = 0x05;
+  acks[1] = 0x05;
+  acks[2] = 0x01;
+  transaction(false);
+  assert(twi.acquire() == ALL);
+  assert(twi.write(0x80, NULL) == 0x05);
+  assert(twi.release());
+  transaction(false);
+  assert(twi.acquire() == ALL);
+  assert(twi.write(0x80, cmd, sizeof(cmd)) == 0x01);
+  assert(twi.release());
+
+  // Read per lane; address not acknowledged on lane 2
+  for (uint8_t lane = 0; lane < LANES; lane++) {
+    data[lane][0] = 0xa0 + lane;
+    data[lane][1] = 0x50 + lane;
+  }
+  acks[0] = 0x03;
+  transaction(true);
+  assert(twi.acquire() == ALL);
+  assert(twi.read(0x80, buf, 2) == 0x03);
+  assert(twi.release());
+  for (uint8_t lane = 0; lane < LANES; lane++) {
+    assert(buf[lane * 2] == 0xa0 + lane);
+    assert(buf[lane * 2 + 1] == 0x50 + lane);
+  }
+
+  // Data signal held low on lane 0; not idle
+  transaction(false);
+  device_low = 0x01;
+  update();
+  assert(twi.acquire() == 0x06);
+  device_low = 0;
+  assert(twi.release());
+
+  // Clock held low by a device; bounded by the transfer timeout
+  acks[0] = acks[1] = acks[2] = ALL;
+  transaction(false);
+  twi.timeout(1);
+  assert(twi.acquire() == ALL);
+  stretching = true;
+  uint32_t start = millis();
+  assert(twi.write(0x80, cmd, sizeof(cmd)) == 0);
+  assert(!twi.release());
+  assert(millis() - start < 10);
+  stretching = false;
+  return (0);
+}
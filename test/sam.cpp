@@ -0,0 +1,248 @@
+/**
+ * @file test/sam.cpp
+ *
+ * Hardware::TWI (SAM) Peripheral DMA Controller (PDC) sequencing
+ * against the TWI registers; interrupt driven and blocking
+ * transfers.
+ */
+
+#define SAM
+#include "Arduino.h"
+#include "TWI.h"
+#include "Hardware/SAM/TWI.h"
+#include <assert.h>
+
+class Bus : public Hardware::TWI {
+public:
+  Twi* regs() { return (m_twi); }
+};
+
+Bus twi;
+Twi* regs = twi.regs();
+
+// Update the interrupt mask register and call the interrupt service
+// routine with the given status flags
+void interrupt(uint32_t sr)
+{
+  regs->TWI_IMR = (regs->TWI_IMR & ~regs->TWI_IDR) | regs->TWI_IER;
+  regs->TWI_IER = 0;
+  regs->TWI_IDR = 0;
+  regs->TWI_SR = sr;
+  twi.isr();
+  regs->TWI_IMR = (regs->TWI_IMR & ~regs->TWI_IDR) | regs->TWI_IER;
+  regs->TWI_IER = 0;
+  regs->TWI_IDR = 0;
+}
+
+uint32_t address(const void* buf)
+{
+  return ((uint32_t) (uintptr_t) buf);
+}
+
+// Status register model; arbitration is lost on the given read of
+// the status register, otherwise the given status flags are set
+uint32_t flags;
+int reads;
+int lost;
+
+void arbitration(uint32_t& sr)
+{
+  reads += 1;
+  sr = (reads == lost) ? (TWI_SR_ARBLST | TWI_SR_TXCOMP) : flags;
+}
+
+// Status register model; page data not acknowledged after the PDC
+// transferred all bytes
+void nack(uint32_t& sr)
+{
+  regs->TWI_TCR = 0;
+  sr = TWI_SR_NACK;
+}
+
+int main()
+{
+  uint8_t cmd[2] = { 0x10, 0x20 };
+  uint8_t page[32];
+  uint8_t buf[20];
+  for (size_t i = 0; i < sizeof(page); i++) page[i] = i;
+  iovec_t vec[3];
+  iovec_t* vp = vec;
+  iovec_arg(vp, cmd, sizeof(cmd));
+  iovec_arg(vp, page, sizeof(page));
+  iovec_end(vp);
+
+  // Interrupt driven; short buffer byte by byte, page with PDC
+  TWI::transaction_t t = { 0x50 << 1, vec, buf, 20, NULL, NULL, 0, false };
+  assert(twi.start(&t));
+  assert(regs->TWI_MMR == (0x50 << 16));
+  interrupt(TWI_SR_TXRDY);
+  assert(regs->TWI_THR == 0x10);
+  interrupt(TWI_SR_TXRDY);
+  assert(regs->TWI_THR == 0x20);
+  interrupt(TWI_SR_TXRDY);
+  assert(regs->TWI_TPR == address(page) && regs->TWI_TCR == 32);
+  assert(regs->TWI_PTCR == TWI_PTCR_TXTEN);
+  assert(regs->TWI_IMR & TWI_SR_ENDTX);
+  assert(!(regs->TWI_IMR & TWI_SR_TXRDY));
+  interrupt(TWI_SR_ENDTX);
+  assert(regs->TWI_PTCR == TWI_PTCR_TXTDIS);
+  interrupt(TWI_SR_TXRDY);
+  assert(regs->TWI_CR == TWI_CR_STOP);
+
+  // Read phase; PDC except the last two bytes, stop before last byte
+  interrupt(TWI_SR_TXCOMP);
+  assert(regs->TWI_MMR == ((0x50 << 16) | TWI_MMR_MREAD));
+  assert(regs->TWI_RPR == address(buf) && regs->TWI_RCR == 18);
+  assert(regs->TWI_PTCR == TWI_PTCR_RXTEN);
+  assert(regs->TWI_CR == TWI_CR_START);
+  interrupt(TWI_SR_ENDRX);
+  assert(regs->TWI_PTCR == TWI_PTCR_RXTDIS);
+  regs->TWI_RHR = 0xa0;
+  interrupt(TWI_SR_RXRDY);
+  assert(regs->TWI_CR == TWI_CR_STOP);
+  regs->TWI_RHR = 0xa1;
+  interrupt(TWI_SR_RXRDY);
+  assert(!t.completed);
+  interrupt(TWI_SR_TXCOMP);
+  assert(t.completed && t.result == 20);
+  assert(buf[18] == 0xa0 && buf[19] == 0xa1);
+  assert(regs->TWI_IMR == 0);
+
+  // Blocking; status flags set, transfers complete directly
+  TWI::Device dev(twi, 0x50);
+  regs->TWI_SR = TWI_SR_TXCOMP | TWI_SR_RXRDY | TWI_SR_TXRDY
+    | TWI_SR_ENDRX | TWI_SR_ENDTX;
+  regs->TWI_TCR = regs->TWI_RCR = 0;
+  assert(dev.acquire());
+  assert(dev.write(vec) == 34);
+  assert(regs->TWI_TPR == address(page) && regs->TWI_TCR == 32);
+  assert(regs->TWI_PTCR == TWI_PTCR_TXTDIS);
+  assert(dev.read(buf, sizeof(buf)) == 20);
+  assert(regs->TWI_RPR == address(buf) && regs->TWI_RCR == 18);
+  assert(regs->TWI_PTCR == TWI_PTCR_RXTDIS);
+  assert(dev.release());
+
+  // Below threshold; byte by byte
+  twi.pdc_threshold(0);
+  regs->TWI_TCR = regs->TWI_RCR = 0;
+  assert(dev.acquire());
+  assert(dev.write(vec) == 34);
+  assert(dev.read(buf, sizeof(buf)) == 20);
+  assert(dev.release());
+  assert(regs->TWI_TCR == 0 && regs->TWI_RCR == 0);
+
+  // Page not acknowledged by the device during PDC write
+  twi.pdc_threshold();
+  regs->TWI_SR = TWI_SR_NACK;
+  vp = vec;
+  iovec_arg(vp, page, sizeof(page));
+  iovec_end(vp);
+  assert(dev.acquire());
+  assert(dev.write(vec) == TWI::E_ADDR_NACK);
+  assert(regs->TWI_PTCR == TWI_PTCR_TXTDIS);
+  assert(twi.acknowledged() == 0);
+  dev.release();
+  twi_sr_model = nack;
+  assert(dev.acquire());
+  assert(dev.write(vec) == TWI::E_DATA_NACK);
+  assert(twi.acknowledged() == 31);
+  dev.release();
+  twi_sr_model = NULL;
+
+  // Interrupt driven; address and page data not acknowledged during
+  // PDC write
+  TWI::transaction_t n = { 0x50 << 1, vec, NULL, 0, NULL, NULL, 0, false };
+  assert(twi.start(&n));
+  interrupt(TWI_SR_TXRDY);
+  assert(regs->TWI_TCR == 32);
+  interrupt(TWI_SR_NACK);
+  assert(n.completed && n.result == TWI::E_ADDR_NACK);
+  assert(regs->TWI_PTCR == (TWI_PTCR_RXTDIS | TWI_PTCR_TXTDIS));
+  n.completed = false;
+  assert(twi.start(&n));
+  interrupt(TWI_SR_TXRDY);
+  regs->TWI_TCR = 20;
+  interrupt(TWI_SR_NACK);
+  assert(n.completed && n.result == TWI::E_DATA_NACK);
+  assert(twi.acknowledged() == 11);
+  n.completed = false;
+  assert(twi.start(&n));
+  interrupt(TWI_SR_TXRDY);
+  regs->TWI_TCR = 0;
+  interrupt(TWI_SR_ENDTX);
+  interrupt(TWI_SR_NACK);
+  assert(n.completed && n.result == TWI::E_DATA_NACK);
+
+  // Arbitration lost in the first phase; the write is retried when
+  // the bus is free
+  uint16_t losses = twi.arbitration_losses();
+  flags = TWI_SR_TXCOMP | TWI_SR_RXRDY | TWI_SR_TXRDY;
+  reads = 0;
+  lost = 1;
+  twi_sr_model = arbitration;
+  twi.pdc_threshold(0);
+  assert(dev.acquire());
+  assert(dev.write(cmd, sizeof(cmd)) == 2);
+  assert(twi.arbitration_losses() == losses + 1);
+
+  // Arbitration lost in a later phase; returned for a full retry
+  lost = reads + 2;
+  assert(dev.read(buf, 2) == TWI::E_ARB_LOST);
+  assert(twi.arbitration_losses() == losses + 2);
+  assert(dev.release());
+
+  // Arbitration lost in the first phase; the read is retried
+  lost = reads + 1;
+  assert(dev.acquire());
+  assert(dev.read(buf, 2) == 2);
+  assert(dev.release());
+  assert(twi.arbitration_losses() == losses + 3);
+  twi_sr_model = NULL;
+
+  // Interrupt driven; the transaction is restarted when the bus is free
+  vp = vec;
+  iovec_arg(vp, cmd, sizeof(cmd));
+  iovec_end(vp);
+  TWI::transaction_t a = { 0x50 << 1, vec, NULL, 0, NULL, NULL, 0, false };
+  assert(twi.start(&a));
+  interrupt(TWI_SR_TXRDY);
+  assert(regs->TWI_THR == 0x10);
+  interrupt(TWI_SR_ARBLST);
+  assert(twi.arbitration_losses() == losses + 4);
+  assert(regs->TWI_MMR == (0x50 << 16));
+  assert(regs->TWI_IMR & TWI_SR_TXRDY);
+  regs->TWI_THR = 0;
+  interrupt(TWI_SR_TXRDY);
+  assert(regs->TWI_THR == 0x10);
+  interrupt(TWI_SR_TXRDY);
+  assert(regs->TWI_THR == 0x20);
+  interrupt(TWI_SR_TXRDY);
+  interrupt(TWI_SR_TXCOMP);
+  assert(a.completed && a.result == 2);
+  twi.pdc_threshold();
+
+  // No progress within the transfer timeout; nine clock pulses and a
+  // stop condition recover the bus
+  twi.timeout(1);
+  regs->TWI_SR = 0;
+  pio_low = 0;
+  assert(dev.acquire());
+  assert(dev.write(cmd, sizeof(cmd)) == TWI::E_TIMEOUT);
+  assert(pio_low == 11);
+  assert(dev.read(buf, sizeof(buf)) == TWI::E_TIMEOUT);
+  assert(pio_low == 22);
+  assert(dev.release());
+
+  // Interrupt driven; the watchdog completes a transaction that does
+  // not make progress within the timeout and recovers the bus
+  TWI::transaction_t w = { 0x50 << 1, vec, buf, 20, NULL, NULL, 0, false };
+  pio_low = 0;
+  assert(twi.start(&w));
+  assert(twi.await(&w) == TWI::E_TIMEOUT);
+  assert(pio_low == 11);
+  assert(regs->TWI_IDR == 0xffffffff);
+  assert(dev.acquire());
+  assert(dev.release());
+  twi.timeout(TWI::DEFAULT_TIMEOUT);
+  return (0);
+}
@@ -0,0 +1,81 @@
+/**
+ * @file test/sim.cpp
+ *
+ * Device drivers against the Sim::TWI slave device models; values
+ * and checksums returned by the drivers.
+ */
+
+#include "Arduino.h"
+#include "TWI.h"
+#include "Sim/TWI.h"
+#include "Sim/BMP085.h"
+#include "Sim/DS2482.h"
+#include "Sim/PCF8574.h"
+#include "Sim/Si70XX.h"
+#include "Driver/BMP085.h"
+#include "Driver/DS2482.h"
+#include "Driver/PCF8574.h"
+#include "Driver/Si70XX.h"
+#include <math.h>
+#include <assert.h>
+
+int main()
+{
+  Sim::TWI twi;
+  Sim::BMP085 bmp085;
+  Sim::DS2482 ds2482;
+  Sim::PCF8574 pcf8574;
+  Sim::Si70XX si70xx;
+  twi.attach(bmp085);
+  twi.attach(ds2482);
+  twi.attach(pcf8574);
+  twi.attach(si70xx);
+
+  // Data sheet example; temperature 15.0 C and pressure 69964 Pa
+  BMP085 bmp(twi);
+  assert(bmp.begin());
+  assert(bmp.sample());
+  assert(bmp.temperature() == 150);
+  assert(bmp.pressure() == 69964);
+
+  // Default raw values; 54.8 %RH and 23.5 C
+  Si70XX si(twi);
+  uint8_t reg;
+  assert(si.read_user_register(reg) && reg == 0x3A);
+  uint8_t rev;
+  assert(si.read_firmware_revision(rev) && rev == 0x20);
+  uint8_t snr[8];
+  assert(si.read_electronic_serial_number(snr));
+  assert(snr[0] == 0x12 && snr[3] == 0x78 && snr[4] == 0x15);
+  si70xx.conversion(3);
+  assert(si.measure_humidity());
+  float humidity = si.read_humidity();
+  assert(fabs(humidity - 54.8) < 0.1);
+  assert(si.measure_temperature());
+  float temperature = si.read_temperature();
+  assert(fabs(temperature - 23.5) < 0.1);
+
+  // Port written and read back; input pins written high
+  PCF8574 pcf(twi);
+  pcf.ddr(0x0f);
+  pcf.write(0xa0);
+  assert(pcf8574.port() == 0xaf);
+  pcf8574.pins(0xff);
+  assert(pcf.read() == 0xaf);
+
+  // Scratchpad block read; CRC over data and checksum is zero
+  static const uint8_t scratchpad[] = {
+    0x50, 0x05, 0x4B, 0x46, 0x7F, 0xFF, 0x0C, 0x10, 0x1C
+  };
+  DS2482 ds(twi);
+  assert(ds.device_reset());
+  assert(ds.write_configuration());
+  assert(ds.one_wire_reset());
+  ds2482.load(scratchpad, sizeof(scratchpad));
+  uint8_t buf[sizeof(scratchpad)];
+  uint8_t crc = 0;
+  assert(ds.one_wire_read(buf, sizeof(buf), crc));
+  assert(crc == 0);
+  assert(memcmp(buf, scratchpad, sizeof(buf)) == 0);
+  return (0);
+}
@@ -0,0 +1,127 @@
+/**
+ * @file test/software.cpp
+ *
+ * Software::TWI bit rate measured with calibrate() against a
+ * simulated time base; delays advance the clock and pin access takes
+ * no time. Pin access per byte counted with a device acknowledging
+ * every byte.
+ */
+
+#include "Arduino.h"
+#include "TWI.h"
+#include <assert.h>
+
+// Time base (us); replaces the Arduino core timing functions of the
+// software bus manager
+uint32_t clock_us;
+
+void delay_us(unsigned int us)
+{
+  clock_us += us;
+}
+
+#define delayMicroseconds(us) ::delay_us(us)
+#define micros() clock_us
+#define millis() (clock_us / 1000)
+#include "Software/TWI.h"
+
+// Bus with released signals; no devices
+bool released(BOARD::pin_t pin, uint8_t op)
+{
+  (void) pin;
+  (void) op;
+  return (true);
+}
+
+// Device acknowledging every byte; data (D18) and clock (D19) pulled
+// low by the master or the device. Pin access is counted
+bool sda_low, scl_low, device_low;
+int bits;
+int accesses;
+
+bool device(BOARD::pin_t pin, uint8_t op)
+{
+  accesses += 1;
+  bool sda = (pin == BOARD::D18);
+  if (op == GPIO_READ) return (sda ? !(sda_low || device_low) : !scl_low);
+  bool low = (op == GPIO_OUTPUT);
+  if (sda) {
+    // Start condition; data falling with clock high
+    if (low && !sda_low && !scl_low) bits = -1;
+    sda_low = low;
+  }
+  else {
+    // Clock falling; acknowledge after eight data bits
+    if (low && !scl_low) {
+      bits += 1;
+      device_low = (bits % 9 == 8);
+    }
+    scl_low = low;
+  }
+  return (true);
+}
+
+// Return number of pin accesses for a write and a read of the given
+// number of bytes within a transaction
+template<bool CLOCK_STRETCHING>
+void count(size_t size, int& write, int& read)
+{
+  Software::TWI<BOARD::D18, BOARD::D19, 0, CLOCK_STRETCHING> twi;
+  TWI::Device dev(twi, 0x50);
+  uint8_t buf[2] = { 0xa5, 0x5a };
+  assert(dev.acquire());
+  accesses = 0;
+  assert(dev.write(buf, size) == (int) size);
+  write = accesses;
+  accesses = 0;
+  assert(dev.read(buf, size) == (int) size);
+  read = accesses;
+  assert(dev.release());
+}
+
+// Return number of pin accesses per byte for a write and a read
+template<bool CLOCK_STRETCHING>
+void per_byte(int& write, int& read)
+{
+  int write1, read1, write2, read2;
+  count<CLOCK_STRETCHING>(1, write1, read1);
+  count<CLOCK_STRETCHING>(2, write2, read2);
+  write = write2 - write1;
+  read = read2 - read1;
+}
+
+template<uint32_t FREQ>
+uint32_t measure()
+{
+  Software::TWI<BOARD::D18, BOARD::D19, FREQ> twi;
+  return (twi.calibrate());
+}
+
+int main()
+{
+  gpio_model = released;
+
+  // Clock period is the sum of the whole micro-second delays; the
+  // low time is rounded up. Fast mode (400 kHz) is limited to a
+  // period of 3 us (333 kHz)
+  assert(measure<100000>() == 111111);
+  assert(measure<400000>() == 333333);
+  assert(measure<1000000>() == 1000000);
+  assert((Software::Timing<400000>::T1 == 1));
+  assert((Software::Timing<400000>::T2 == 2));
+
+  // No delays; limited by the pin access time only
+  assert(measure<0>() == 1000000000);
+
+  // Pin access per byte; three per data bit, a data read per written
+  // one bit (arbitration, four in 0x5a), and five for acknowledge.
+  // Clock stretching checked on the first data bit and the
+  // acknowledge bit only (37 and 44 when checked on every bit)
+  gpio_model = device;
+  int write, read;
+  per_byte<true>(write, read);
+  assert(write == 34 && read == 30);
+  per_byte<false>(write, read);
+  assert(write == 32 && read == 28);
+  return (0);
+}
@@ -0,0 +1,20 @@
+/**
+ * @file test/stub/Arduino.h
+ *
+ * Arduino core for host tests; the Linux core functions and the
+ * register model of the platform given by AVR or SAM.
+ */
+
+#ifndef TEST_ARDUINO_H
+#define TEST_ARDUINO_H
+
+#include "Linux/Arduino.h"
+
+#define _BV(bit) (1 << (bit))
+
+#if defined(AVR)
+#include "avr.h"
+#elif defined(SAM)
+#include "include/twi.h"
+#endif
+#endif
@@ -0,0 +1,56 @@
+/**
+ * @file test/stub/GPIO.h
+ *
+ * GPIO pins for host tests. Pin access is forwarded to the bus
+ * model of the test; release (input), drive low (output) and read.
+ * Pin P0 is bit 0 of a port with the registers at address 0x100000
+ * (mapped by the test). Included by a single translation unit per
+ * test.
+ */
+
+#ifndef TEST_GPIO_H
+#define TEST_GPIO_H
+
+namespace BOARD {
+  enum pin_t {
+    D8 = 0x230,
+    D9 = 0x231,
+    D18 = 0x290,
+    D19 = 0x291,
+    P0 = 0x1000000
+  };
+};
+
+/** Pin access operations. */
+enum {
+  GPIO_INPUT,
+  GPIO_OUTPUT,
+  GPIO_READ
+};
+
+/** Bus model; called with pin and operation, returns pin level. */
+static bool (*gpio_model)(BOARD::pin_t pin, uint8_t op) = NULL;
+
+template<BOARD::pin_t PIN>
+class GPIO {
+public:
+  void open_drain()
+  {
+  }
+
+  void input()
+  {
+    gpio_model(PIN, GPIO_INPUT);
+  }
+
+  void output()
+  {
+    gpio_model(PIN, GPIO_OUTPUT);
+  }
+
+  operator bool()
+  {
+    return (gpio_model(PIN, GPIO_READ));
+  }
+};
+#endif
@@ -0,0 +1,79 @@
+/**
+ * @file test/stub/avr.h
+ *
+ * AVR TWI registers and core functions for host tests. Writing the
+ * control register calls the register model (when set) to perform
+ * the command and update the status and data registers. Included
+ * by a single translation unit per test.
+ */
+
+#ifndef TEST_AVR_H
+#define TEST_AVR_H
+
+#define F_CPU 16000000UL
+
+#define TWINT 7
+#define TWEA 6
+#define TWSTA 5
+#define TWSTO 4
+#define TWWC 3
+#define TWEN 2
+#define TWIE 0
+
+/** Register model; called with the written control register value. */
+static void (*twi_model)(uint8_t cr) = NULL;
+
+/** Control register; written commands are performed by the model. */
+struct twcr_t {
+  uint8_t value;
+
+  twcr_t& operator=(uint8_t cr)
+  {
+    value = cr;
+    if (twi_model != NULL) twi_model(cr);
+    return (*this);
+  }
+
+  operator uint8_t() const
+  {
+    return (value);
+  }
+};
+
+static twcr_t TWCR __attribute__((unused));
+static volatile uint8_t TWSR, TWDR, TWBR;
+static volatile uint8_t SREG;
+
+#define SREG_I 7
+
+inline void cli()
+{
+  SREG &= ~_BV(SREG_I);
+}
+
+#define bit_is_clear(reg, bit) (!((reg) & _BV(bit)))
+
+#define SDA 18
+#define SCL 19
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+
+static uint8_t pin_mode[32], pin_level[32];
+
+inline void pinMode(uint8_t pin, uint8_t mode)
+{
+  pin_mode[pin] = mode;
+}
+
+inline void digitalWrite(uint8_t pin, uint8_t value)
+{
+  pin_level[pin] = value;
+}
+
+inline int digitalRead(uint8_t pin)
+{
+  return (pin_mode[pin] == OUTPUT ? pin_level[pin] : HIGH);
+}
+#endif
@@ -0,0 +1,26 @@
+/**
+ * @file test/stub/bswap.h
+ *
+ * Host version of the byte swap functions.
+ */
+
+#ifndef TEST_BSWAP_H
+#define TEST_BSWAP_H
+
+#include <stdint.h>
+
+inline uint16_t bswap16(uint16_t value)
+{
+  return (__builtin_bswap16(value));
+}
+
+inline int16_t bswap16(int16_t value)
+{
+  return ((int16_t) __builtin_bswap16(value));
+}
+
+inline uint32_t bswap32(uint32_t value)
+{
+  return (__builtin_bswap32(value));
+}
+#endif
@@ -0,0 +1,132 @@
+/**
+ * @file test/stub/include/twi.h
+ *
+ * SAM3X TWI registers (libsam) for host tests. The registers are
+ * plain memory except the status register; the test sets the status
+ * and mask registers and checks the written control and PDC
+ * registers. Included by a single translation unit per test.
+ */
+
+#ifndef TEST_INCLUDE_TWI_H
+#define TEST_INCLUDE_TWI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TWI_CR_START (1u << 0)
+#define TWI_CR_STOP (1u << 1)
+#define TWI_MMR_IADRSZ_Pos 8
+#define TWI_MMR_MREAD (1u << 12)
+#define TWI_SR_TXCOMP (1u << 0)
+#define TWI_SR_RXRDY (1u << 1)
+#define TWI_SR_TXRDY (1u << 2)
+#define TWI_SR_NACK (1u << 8)
+#define TWI_SR_ARBLST (1u << 9)
+#define TWI_SR_ENDRX (1u << 12)
+#define TWI_SR_ENDTX (1u << 13)
+#define TWI_IER_TXCOMP TWI_SR_TXCOMP
+#define TWI_IER_RXRDY TWI_SR_RXRDY
+#define TWI_IER_TXRDY TWI_SR_TXRDY
+#define TWI_IER_NACK TWI_SR_NACK
+#define TWI_IER_ARBLST TWI_SR_ARBLST
+#define TWI_IER_ENDRX TWI_SR_ENDRX
+#define TWI_IER_ENDTX TWI_SR_ENDTX
+#define TWI_IDR_TXCOMP TWI_SR_TXCOMP
+#define TWI_IDR_RXRDY TWI_SR_RXRDY
+#define TWI_IDR_TXRDY TWI_SR_TXRDY
+#define TWI_IDR_ENDRX TWI_SR_ENDRX
+#define TWI_IDR_ENDTX TWI_SR_ENDTX
+#define TWI_IMR_ENDTX TWI_SR_ENDTX
+#define TWI_PTCR_RXTEN (1u << 0)
+#define TWI_PTCR_RXTDIS (1u << 1)
+#define TWI_PTCR_TXTEN (1u << 8)
+#define TWI_PTCR_TXTDIS (1u << 9)
+
+// Status register model; called before the status register is read
+static void (*twi_sr_model)(uint32_t& sr);
+
+// Status register; not acknowledged and arbitration lost are cleared
+// on read
+struct twi_sr_t {
+  uint32_t value;
+
+  void operator=(uint32_t sr)
+  {
+    value = sr;
+  }
+
+  operator uint32_t()
+  {
+    if (twi_sr_model != NULL) twi_sr_model(value);
+    uint32_t sr = value;
+    value &= ~(TWI_SR_NACK | TWI_SR_ARBLST);
+    return (sr);
+  }
+};
+
+struct Twi {
+  volatile uint32_t TWI_CR;
+  volatile uint32_t TWI_MMR;
+  volatile uint32_t TWI_SMR;
+  volatile uint32_t TWI_IADR;
+  volatile uint32_t TWI_CWGR;
+  twi_sr_t TWI_SR;
+  volatile uint32_t TWI_IER;
+  volatile uint32_t TWI_IDR;
+  volatile uint32_t TWI_IMR;
+  volatile uint32_t TWI_RHR;
+  volatile uint32_t TWI_THR;
+  volatile uint32_t TWI_RPR;
+  volatile uint32_t TWI_RCR;
+  volatile uint32_t TWI_TPR;
+  volatile uint32_t TWI_TCR;
+  volatile uint32_t TWI_PTCR;
+  volatile uint32_t TWI_PTSR;
+};
+
+static Twi twi0_regs, twi1_regs;
+#define TWI0 (&twi0_regs)
+#define TWI1 (&twi1_regs)
+#define ID_TWI0 22
+#define ID_TWI1 23
+
+typedef int IRQn_Type;
+#define TWI0_IRQn 22
+#define TWI1_IRQn 23
+
+inline void TWI_ConfigureMaster(Twi* twi, uint32_t freq, uint32_t mck)
+{
+  (void) twi;
+  (void) freq;
+  (void) mck;
+}
+
+inline void pmc_enable_periph_clk(uint32_t id)
+{
+  (void) id;
+}
+
+inline void NVIC_EnableIRQ(IRQn_Type irq)
+{
+  (void) irq;
+}
+
+inline void NVIC_ClearPendingIRQ(IRQn_Type irq)
+{
+  (void) irq;
+}
+
+inline uint32_t __get_PRIMASK()
+{
+  return (0);
+}
+
+inline void __set_PRIMASK(uint32_t primask)
+{
+  (void) primask;
+}
+
+inline void __disable_irq()
+{
+}
+#endif
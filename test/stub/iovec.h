@@ -0,0 +1,29 @@
+/**
+ * @file test/stub/iovec.h
+ *
+ * Host version of the io vector buffer functions.
+ */
+
+#ifndef TEST_IOVEC_H
+#define TEST_IOVEC_H
+
+#include <stddef.h>
+
+struct iovec_t {
+  void* buf;
+  size_t size;
+};
+
+inline void iovec_arg(iovec_t* &vp, const void* buf, size_t size)
+{
+  vp->buf = (void*) buf;
+  vp->size = size;
+  vp++;
+}
+
+inline void iovec_end(iovec_t* &vp)
+{
+  vp->buf = NULL;
+  vp->size = 0;
+}
+#endif
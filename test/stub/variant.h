@@ -0,0 +1,63 @@
+/**
+ * @file test/stub/variant.h
+ *
+ * Arduino Due variant definitions for host tests.
+ */
+
+#ifndef TEST_VARIANT_H
+#define TEST_VARIANT_H
+
+#include "include/twi.h"
+
+#define VARIANT_MCK 84000000
+#define WIRE_INTERFACES_COUNT 2
+#define WIRE_INTERFACE TWI1
+#define WIRE_INTERFACE_ID ID_TWI1
+#define WIRE_ISR_ID TWI1_IRQn
+#define WIRE1_INTERFACE TWI0
+#define WIRE1_INTERFACE_ID ID_TWI0
+#define WIRE1_ISR_ID TWI0_IRQn
+#define PIN_WIRE_SDA 20
+#define PIN_WIRE_SCL 21
+#define PIN_WIRE1_SDA 70
+#define PIN_WIRE1_SCL 71
+
+enum EPioType {
+  PIO_NOT_A_PIN,
+  PIO_PERIPH_A,
+  PIO_PERIPH_B,
+  PIO_INPUT,
+  PIO_OUTPUT_0,
+  PIO_OUTPUT_1
+};
+
+#define PIO_DEFAULT 0
+
+struct PinDescription {
+  void* pPort;
+  EPioType ulPinType;
+  uint32_t ulPin;
+  uint32_t ulPinConfiguration;
+};
+
+static PinDescription g_APinDescription[72];
+
+// Number of times a pin has been pulled low (open drain)
+static int pio_low;
+
+inline void PIO_Configure(void* port, EPioType type, uint32_t pin,
+			  uint32_t config)
+{
+  (void) port;
+  (void) pin;
+  (void) config;
+  if (type == PIO_OUTPUT_0) pio_low += 1;
+}
+
+inline uint32_t PIO_Get(void* port, EPioType type, uint32_t pin)
+{
+  (void) port;
+  (void) type;
+  return (pin | 1);
+}
+#endif